@@ -0,0 +1,311 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <stdexcept>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <imgui.h>
+#include "headless.h"
+
+namespace ImPlay {
+Headless::Headless(Config *config, int width, int height) : Player(config), fbWidth(width), fbHeight(height) {
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != nullptr)
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    throw std::runtime_error("Failed to initialize EGL!");
+
+#ifdef IMGUI_IMPL_OPENGL_ES3
+  eglBindAPI(EGL_OPENGL_ES_API);
+  EGLint renderable = EGL_OPENGL_ES3_BIT;
+#else
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint renderable = EGL_OPENGL_BIT;
+#endif
+  EGLint configAttribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, renderable, EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE,   8,               EGL_BLUE_SIZE,       8,          EGL_NONE,
+  };
+  EGLConfig eglConfig;
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(display, configAttribs, &eglConfig, 1, &numConfigs) || numConfigs == 0)
+    throw std::runtime_error("Failed to choose EGL config!");
+
+  EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE};
+  context = eglCreateContext(display, eglConfig, EGL_NO_CONTEXT, contextAttribs);
+  if (context == EGL_NO_CONTEXT) throw std::runtime_error("Failed to create EGL context!");
+  videoContext = eglCreateContext(display, eglConfig, context, contextAttribs);
+  if (videoContext == EGL_NO_CONTEXT) throw std::runtime_error("Failed to create video context!");
+
+  config->Data.Interface.Viewports = false;
+  config->Data.Interface.Fps = 1000;  // no vsync, frames are finished with glFinish
+  initGui();
+
+  glGenRenderbuffers(1, &rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fbWidth, fbHeight);
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    throw std::runtime_error("Failed to create framebuffer!");
+}
+
+Headless::~Headless() {
+  MakeContextCurrent();
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &rbo);
+  exitGui();
+  DeleteContext();
+  eglDestroyContext(display, videoContext);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+}
+
+bool Headless::init(std::map<std::string, std::string> &options) {
+  mpv->wakeupCb() = [this](Mpv *ctx) { wakeup(); };
+  return Player::init(options);
+}
+
+// plays path for duration seconds (or until it ends), returns the measurements
+nlohmann::json Headless::run(const std::string &path, double duration) {
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+
+  startVideo();
+  mpv->commandv("loadfile", path.c_str(), nullptr);
+
+  std::vector<int64_t> renderTimes;
+  auto start = clock::now();
+  auto end = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(duration));
+  lastFrame = start;
+  while (!shouldClose && clock::now() < end) {
+    double delay = videoDelay();
+    auto timeout = std::chrono::duration<double>(delay >= 0 ? delay : 0.1);
+    notifier.wait_until(clock::now() + std::chrono::duration_cast<clock::duration>(timeout));
+    if (mpv->processEvents()) invalidate();
+
+    uint64_t presented = metrics.pacing.frames;
+    auto t = clock::now();
+    render();
+    if (metrics.pacing.frames != presented) renderTimes.push_back(us(clock::now() - t));
+  }
+  double elapsed = us(clock::now() - start) / 1e6;
+
+  auto dropped = mpv->property<int64_t, MPV_FORMAT_INT64>("frame-drop-count");
+  auto decoderDropped = mpv->property<int64_t, MPV_FORMAT_INT64>("decoder-frame-drop-count");
+  auto delayed = mpv->property<int64_t, MPV_FORMAT_INT64>("vo-delayed-frame-count");
+  auto renderer = glGetString(GL_RENDERER);
+  mpv->command("stop");
+  stopVideo();
+
+  nlohmann::json result;
+  result["file"] = path;
+  result["renderer"] = renderer != nullptr ? (const char *)renderer : "";
+  result["width"] = fbWidth;
+  result["height"] = fbHeight;
+  result["duration"] = elapsed;
+  result["frames"] = renderTimes.size();  // presented frames, render_ms is the CPU time of render() for them
+  result["fps"] = elapsed > 0 ? renderTimes.size() / elapsed : 0;
+  result["dropped_frames"] = dropped;
+  result["decoder_dropped_frames"] = decoderDropped;
+  result["delayed_frames"] = delayed;
+  result["pacing"] = {
+      {"on_time", metrics.pacing.onTime},
+      {"missed_vsyncs", metrics.pacing.missed},
+      {"duplicated_vsyncs", metrics.pacing.duplicated},
+  };
+
+  std::sort(renderTimes.begin(), renderTimes.end());
+  auto percentile = [&](double p) {
+    if (renderTimes.empty()) return 0.0;
+    return renderTimes[static_cast<size_t>(p * (renderTimes.size() - 1))] / 1000.0;
+  };
+  result["render_ms"] = {
+      {"p50", percentile(0.50)},
+      {"p95", percentile(0.95)},
+      {"p99", percentile(0.99)},
+      {"max", percentile(1.0)},
+  };
+  for (int i = 0; i < Metrics::PHASE_COUNT; i++) {
+    auto s = metrics.phases[i].summary();
+    result["phases_ms"][Metrics::phaseName((Metrics::Phase)i)] = {
+        {"p50", s.p50 / 1000.0},
+        {"p95", s.p95 / 1000.0},
+        {"p99", s.p99 / 1000.0},
+        {"max", s.max / 1000.0},
+    };
+  }
+  return result;
+}
+
+// Builds a synthetic playlist of entries files, then times how long list changes take to reach the published
+// state: the initial load, single appends at that size, a move, a removal and a shuffle.
+nlohmann::json Headless::playlist(int entries, int appends) {
+  startVideo();
+  mpv->command("playlist-clear");
+  waitState([](const Mpv::State &s) { return s.playlist->empty(); });
+  maxFrameMs = 0;
+
+  std::string list = "#EXTM3U";
+  for (int i = 0; i < entries; i++) list += fmt::format("\n/bench/playlist/{:06}.flac", i);
+  mpv->commandv("loadlist", fmt::format("memory://{}", list).c_str(), "append", nullptr);
+  double load = waitState([&](const Mpv::State &s) { return (int)s.playlist->size() == entries; });
+  double bytesPerEntry = entries > 0 ? (double)mpv->state()->playlist->memoryUsage() / entries : 0;
+
+  std::vector<double> appendTimes;
+  for (int i = 0; i < appends; i++) {
+    mpv->commandv("loadfile", fmt::format("/bench/playlist/extra-{:06}.flac", i).c_str(), "append", nullptr);
+    size_t size = entries + i + 1;
+    appendTimes.push_back(waitState([&](const Mpv::State &s) { return s.playlist->size() == size; }));
+  }
+
+  auto before = mpv->state()->playlist;
+  mpv->commandv("playlist-move", "0", std::to_string(before->size()).c_str(), nullptr);
+  double move = waitState([&](const Mpv::State &s) { return s.playlist->back().entryId == before->front().entryId; });
+
+  before = mpv->state()->playlist;
+  mpv->command("playlist-remove 0");
+  double remove = waitState([&](const Mpv::State &s) { return s.playlist->size() == before->size() - 1; });
+
+  before = mpv->state()->playlist;
+  mpv->command("playlist-shuffle");
+  double shuffle = waitState([&](const Mpv::State &s) { return s.playlist != before; });
+
+  mpv->command("playlist-clear");
+  waitState([](const Mpv::State &s) { return s.playlist->empty(); });
+  stopVideo();
+
+  std::sort(appendTimes.begin(), appendTimes.end());
+  auto percentile = [&](double p) {
+    if (appendTimes.empty()) return 0.0;
+    return appendTimes[static_cast<size_t>(p * (appendTimes.size() - 1))];
+  };
+
+  nlohmann::json result;
+  result["entries"] = entries;
+  result["load_ms"] = load;
+  result["bytes_per_entry"] = bytesPerEntry;
+  result["append_ms"] = {
+      {"count", appendTimes.size()},
+      {"p50", percentile(0.50)},
+      {"p95", percentile(0.95)},
+      {"max", percentile(1.0)},
+  };
+  result["move_ms"] = move;
+  result["remove_ms"] = remove;
+  result["shuffle_ms"] = shuffle;
+  result["ui_frame_max_ms"] = maxFrameMs;
+  return result;
+}
+
+// Opens the command palette on a synthetic playlist of entries files and times render() drawing it.
+nlohmann::json Headless::palette(int entries, int frames) {
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+  startVideo();
+  mpv->command("playlist-clear");
+  waitState([](const Mpv::State &s) { return s.playlist->empty(); });
+  std::string list = "#EXTM3U";
+  for (int i = 0; i < entries; i++) list += fmt::format("\n/bench/palette/Album {:04}/{:06} - Track.flac", i / 20, i);
+  mpv->commandv("loadlist", fmt::format("memory://{}", list).c_str(), "append", nullptr);
+  waitState([&](const Mpv::State &s) { return (int)s.playlist->size() == entries; });
+
+  mpv->command("script-message-to implay command-palette playlist");
+  auto opened = [] { return ImGui::GetCurrentContext()->OpenPopupStack.Size > 0; };
+  auto start = clock::now();
+  while (!opened()) {
+    if (clock::now() - start > std::chrono::seconds(60)) throw std::runtime_error("Timed out waiting for mpv!");
+    notifier.wait_until(clock::now() + std::chrono::milliseconds(100));
+    mpv->processEvents();
+    invalidate();
+    render();
+  }
+  double open = ms(clock::now() - start);
+
+  std::vector<double> renderTimes;
+  for (int i = 0; i < frames; i++) {
+    invalidate();
+    auto t = clock::now();
+    render();
+    renderTimes.push_back(ms(clock::now() - t));
+  }
+
+  mpv->command("playlist-clear");
+  waitState([](const Mpv::State &s) { return s.playlist->empty(); });
+  stopVideo();
+
+  std::sort(renderTimes.begin(), renderTimes.end());
+  auto percentile = [&](double p) {
+    if (renderTimes.empty()) return 0.0;
+    return renderTimes[static_cast<size_t>(p * (renderTimes.size() - 1))];
+  };
+
+  nlohmann::json result;
+  result["entries"] = entries;
+  result["open_ms"] = open;
+  result["render_ms"] = {
+      {"count", renderTimes.size()},
+      {"p50", percentile(0.50)},
+      {"p95", percentile(0.95)},
+      {"max", percentile(1.0)},
+  };
+  return result;
+}
+
+// keeps the UI loop running until done returns true for the published state, returns the elapsed milliseconds
+double Headless::waitState(const std::function<bool(const Mpv::State &)> &done) {
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  while (!done(*mpv->state())) {
+    if (clock::now() - start > std::chrono::seconds(60)) throw std::runtime_error("Timed out waiting for mpv!");
+    notifier.wait_until(clock::now() + std::chrono::milliseconds(100));
+    auto t = clock::now();
+    if (mpv->processEvents()) invalidate();
+    render();
+    maxFrameMs = std::max(maxFrameMs, std::chrono::duration<double, std::milli>(clock::now() - t).count());
+  }
+  return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+}
+
+void Headless::wakeup() { notifier.notify(); }
+
+GLAddrLoadFunc Headless::GetGLAddrFunc() { return (GLAddrLoadFunc)eglGetProcAddress; }
+
+void Headless::GetMonitorSize(int *w, int *h) {
+  *w = fbWidth;
+  *h = fbHeight;
+}
+
+void Headless::GetFramebufferSize(int *w, int *h) {
+  *w = fbWidth;
+  *h = fbHeight;
+}
+
+void Headless::MakeContextCurrent() { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context); }
+
+void Headless::MakeVideoContextCurrent() { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, videoContext); }
+
+void Headless::DeleteContext() { eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+void Headless::SwapBuffers() { glFinish(); }
+
+void Headless::BackendNewFrame() {
+  auto now = std::chrono::steady_clock::now();
+  ImGuiIO &io = ImGui::GetIO();
+  io.DisplaySize = ImVec2((float)fbWidth, (float)fbHeight);
+  io.DeltaTime = std::max(std::chrono::duration<float>(now - lastFrame).count(), 1e-6f);
+  lastFrame = now;
+}
+
+void Headless::GetWindowScale(float *x, float *y) { *x = *y = 1.0f; }
+
+void Headless::GetWindowPos(int *x, int *y) { *x = *y = 0; }
+
+void Headless::GetWindowSize(int *w, int *h) {
+  *w = fbWidth;
+  *h = fbHeight;
+}
+}  // namespace ImPlay
@@ -0,0 +1,62 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <EGL/egl.h>
+#include <nlohmann/json.hpp>
+#include "player.h"
+
+namespace ImPlay {
+// Player on an offscreen EGL context (surfaceless, no window system needed), renders into a framebuffer object.
+class Headless : Player {
+ public:
+  Headless(Config *config, int width, int height);
+  ~Headless();
+
+  bool init(std::map<std::string, std::string> &options);
+  nlohmann::json run(const std::string &path, double duration);
+  nlohmann::json playlist(int entries, int appends);
+  nlohmann::json palette(int entries, int frames);
+
+ private:
+  void wakeup() override;
+  double waitState(const std::function<bool(const Mpv::State &)> &done);
+
+  GLAddrLoadFunc GetGLAddrFunc() override;
+  std::string GetClipboardString() override { return ""; }
+  void GetMonitorSize(int *w, int *h) override;
+  int GetMonitorRefreshRate() override { return 60; }
+  void GetFramebufferSize(int *w, int *h) override;
+  GLuint GetFramebuffer() override { return fbo; }
+  void MakeContextCurrent() override;
+  void MakeVideoContextCurrent() override;
+  void DeleteContext() override;
+  void SwapBuffers() override;
+  void SetSwapInterval(int interval) override {}
+  void BackendNewFrame() override;
+  void GetWindowScale(float *x, float *y) override;
+  void GetWindowPos(int *x, int *y) override;
+  void SetWindowPos(int x, int y) override {}
+  void GetWindowSize(int *w, int *h) override;
+  void SetWindowSize(int w, int h) override {}
+  void SetWindowTitle(std::string title) override {}
+  void SetWindowAspectRatio(int num, int den) override {}
+  void SetWindowMaximized(bool m) override {}
+  void SetWindowMinimized(bool m) override {}
+  void SetWindowDecorated(bool d) override {}
+  void SetWindowFloating(bool f) override {}
+  void SetWindowFullscreen(bool fs) override {}
+  void SetWindowShouldClose(bool c) override { shouldClose = c; }
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  EGLContext videoContext = EGL_NO_CONTEXT;
+  GLuint fbo = 0, rbo = 0;
+  int fbWidth, fbHeight;
+  bool shouldClose = false;
+  std::chrono::steady_clock::time_point lastFrame;
+  double maxFrameMs = 0;
+
+  Notifier notifier;
+};
+}  // namespace ImPlay
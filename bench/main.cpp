@@ -0,0 +1,270 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <fstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+#include <strnatcmp.h>
+#include "helpers/natsort.h"
+#include "helpers/utils.h"
+#include "playlist.h"
+#include "headless.h"
+
+static const char* usage =
+    "Usage:   ImPlayBench <benchmark> [options]\n"
+    "\n"
+    "Benchmarks:\n"
+    " render [file]       play a file (default: generated test clip) offscreen\n"
+    "   --width=<px>      framebuffer width (default: 1920)\n"
+    "   --height=<px>     framebuffer height (default: 1080)\n"
+    "   --rate=<fps>      frame rate of the test clip (default: 60)\n"
+    "   --duration=<sec>  how long to play (default: 10)\n"
+    "   --untimed         render frames as fast as possible\n"
+    " playlist            time playlist updates on a large synthetic playlist\n"
+    "   --entries=<n>     playlist size (default: 100000)\n"
+    "   --appends=<n>     single entries appended after loading (default: 100)\n"
+    " palette             time frames of the command palette listing a large playlist\n"
+    "   --entries=<n>     playlist size (default: 200000)\n"
+    "   --frames=<n>      frames to draw (default: 300)\n"
+    " playlist-memory     memory and build time of the playlist store, no mpv involved\n"
+    "   --entries=<n>     playlist size (default: 1000000)\n"
+    " playlist-sort       natural sort of a shuffled playlist and the moves to apply it, no mpv involved\n"
+    "   --entries=<n,..>  playlist sizes (default: 10000,100000)\n"
+    "\n"
+    "Common options:\n"
+    " --output=<file>     write the JSON result to file instead of stdout\n";
+
+static std::string option(ImPlay::OptionParser& parser, const char* key, const char* value) {
+  auto it = parser.options.find(key);
+  return it != parser.options.end() ? it->second : value;
+}
+
+static nlohmann::json bench_render(ImPlay::OptionParser& parser) {
+  int width = std::stoi(option(parser, "width", "1920"));
+  int height = std::stoi(option(parser, "height", "1080"));
+  auto rate = option(parser, "rate", "60");
+  double duration = std::stod(option(parser, "duration", "10"));
+  std::string path = fmt::format("av://lavfi:testsrc2=size={}x{}:rate={}", width, height, rate);
+  if (parser.paths.size() > 1) path = parser.paths[1];
+
+  ImPlay::Config config;
+  config.Data.Mpv.UseConfig = true;  // don't write mpv.conf to the user's config dir
+
+  std::map<std::string, std::string> options = {
+      {"config", "no"},
+      {"terminal", "no"},
+      {"ao", "null"},
+      {"keep-open", "yes"},
+      {"untimed", parser.check("untimed", "yes") ? "yes" : "no"},
+  };
+  ImPlay::Headless player(&config, width, height);
+  if (!player.init(options)) throw std::runtime_error("Failed to initialize player!");
+
+  auto result = player.run(path, duration);
+  result["benchmark"] = "render";
+  result["untimed"] = parser.check("untimed", "yes");
+  return result;
+}
+
+static nlohmann::json bench_playlist(ImPlay::OptionParser& parser) {
+  int entries = std::stoi(option(parser, "entries", "100000"));
+  int appends = std::stoi(option(parser, "appends", "100"));
+
+  ImPlay::Config config;
+  config.Data.Mpv.UseConfig = true;
+
+  std::map<std::string, std::string> options = {
+      {"config", "no"},
+      {"terminal", "no"},
+      {"ao", "null"},
+      {"idle", "yes"},
+  };
+  ImPlay::Headless player(&config, 1280, 720);
+  if (!player.init(options)) throw std::runtime_error("Failed to initialize player!");
+
+  auto result = player.playlist(entries, appends);
+  result["benchmark"] = "playlist";
+  return result;
+}
+
+static nlohmann::json bench_palette(ImPlay::OptionParser& parser) {
+  int entries = std::stoi(option(parser, "entries", "200000"));
+  int frames = std::stoi(option(parser, "frames", "300"));
+
+  ImPlay::Config config;
+  config.Data.Mpv.UseConfig = true;
+
+  std::map<std::string, std::string> options = {
+      {"config", "no"},
+      {"terminal", "no"},
+      {"ao", "null"},
+      {"idle", "yes"},
+  };
+  ImPlay::Headless player(&config, 1280, 720);
+  if (!player.init(options)) throw std::runtime_error("Failed to initialize player!");
+
+  auto result = player.palette(entries, frames);
+  result["benchmark"] = "palette";
+  return result;
+}
+
+// Archive-like paths: a few collections of artists with albums of 20 tracks each.
+static nlohmann::json bench_playlist_memory(ImPlay::OptionParser& parser) {
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  int entries = std::stoi(option(parser, "entries", "1000000"));
+
+  std::vector<std::string> paths;
+  paths.reserve(entries + 1);
+  for (int i = 0; i <= entries; i++)
+    paths.push_back(fmt::format("/archive/collection-{:03}/artist-{:05}/album-{:06}/{:02} - Track {}.flac", i / 100000,
+                                i / 500, i / 20, i % 20 + 1, i));
+  std::vector<ImPlay::Playlist::Entry> input;
+  input.reserve(entries + 1);
+  for (int i = 0; i <= entries; i++) input.push_back({i + 1, "", paths[i]});
+  auto extra = input.back();
+  input.pop_back();
+
+  auto t = clock::now();
+  auto list = ImPlay::Playlist::build(input, nullptr);
+  double build = ms(clock::now() - t);
+
+  input.push_back(extra);
+  t = clock::now();
+  auto appended = ImPlay::Playlist::build(input, list.get());
+  double append = ms(clock::now() - t);
+
+  t = clock::now();
+  size_t chars = 0;
+  for (auto item : *appended) chars += item.dir.size() + item.name.size();
+  double iterate = ms(clock::now() - t);
+
+  // what the previous vector of {id, std::string title, std::filesystem::path} took, heap blocks for strings
+  // that don't fit the small string buffer are estimated at their size rounded up to 16 bytes
+  struct LegacyItem {
+    int64_t id;
+    std::string title;
+    std::filesystem::path path;
+  };
+  size_t legacy = 0;
+  for (int i = 0; i < entries; i++) {
+    legacy += sizeof(LegacyItem);
+    if (paths[i].size() > 15) legacy += (paths[i].size() + 16) & ~(size_t)15;
+  }
+
+  nlohmann::json result;
+  result["benchmark"] = "playlist-memory";
+  result["entries"] = entries;
+  result["build_ms"] = build;
+  result["append_one_ms"] = append;
+  result["iterate_ms"] = iterate;
+  result["path_bytes"] = chars;
+  result["bytes_per_entry"] = entries > 0 ? (double)list->memoryUsage() / entries : 0;
+  result["legacy_bytes_per_entry"] = entries > 0 ? (double)legacy / entries : 0;
+  return result;
+}
+
+// Track names of albums in shuffled order. Compares the previous sort, which built both strings in every
+// comparison, with the key-based one, and times the moves that apply a sort after a few entries were
+// appended out of order.
+static nlohmann::json bench_playlist_sort(ImPlay::OptionParser& parser) {
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  auto sizes = ImPlay::split(option(parser, "entries", "10000,100000"), ",");
+
+  nlohmann::json result;
+  result["benchmark"] = "playlist-sort";
+  for (auto& size : sizes) {
+    int entries = std::stoi(size);
+    std::vector<std::string> paths;
+    for (int i = 0; i < entries; i++)
+      paths.push_back(fmt::format("/music/Artist {}/Album {}/{} - Track {}.flac", i / 200, i / 20, i % 20 + 1, i));
+    std::shuffle(paths.begin(), paths.end(), std::mt19937(entries));
+    std::vector<ImPlay::Playlist::Entry> input;
+    for (int i = 0; i < entries; i++) input.push_back({i + 1, "", paths[i]});
+    auto list = ImPlay::Playlist::build(input, nullptr);
+
+    auto t = clock::now();
+    std::vector<ImPlay::Playlist::Item> items(list->begin(), list->end());
+    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+      std::string str1(a.title != "" ? a.title : a.name);
+      std::string str2(b.title != "" ? b.title : b.name);
+      return strnatcasecmp(str1.c_str(), str2.c_str()) < 0;
+    });
+    double legacy = ms(clock::now() - t);
+
+    t = clock::now();
+    ImPlay::NaturalSort sort;
+    sort.reserve(list->size());
+    for (auto item : *list) sort.add(item.title.empty() ? item.name : item.title);
+    double keys = ms(clock::now() - t);
+
+    t = clock::now();
+    auto order = sort.sort(false, false);
+    double serial = ms(clock::now() - t);
+    t = clock::now();
+    order = sort.sort();
+    double parallel = ms(clock::now() - t);
+
+    // a sorted list with every 100th entry appended at the end instead of in its place
+    std::vector<uint32_t> appended(order.size());
+    size_t tail = order.size() / 100, head = order.size() - tail;
+    for (size_t i = 0; i < order.size(); i++) appended[i] = (uint32_t)(i % 100 == 99 ? head + i / 100 : i - i / 100);
+    t = clock::now();
+    auto moves = ImPlay::NaturalSort::moves(appended, tail);
+    double move = ms(clock::now() - t);
+
+    result["sizes"].push_back({
+        {"entries", entries},
+        {"legacy_sort_ms", legacy},
+        {"keys_ms", keys},
+        {"sort_ms", serial},
+        {"parallel_sort_ms", parallel},
+        {"moves", moves ? moves->size() : 0},
+        {"moves_ms", move},
+    });
+  }
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  ImPlay::OptionParser parser;
+  parser.parse(argc, argv);
+  if (parser.paths.empty() || parser.options.contains("help")) {
+    fmt::print("{}", usage);
+    return parser.paths.empty() ? 1 : 0;
+  }
+
+  try {
+    nlohmann::json result;
+    auto name = parser.paths[0];
+    if (name == "render")
+      result = bench_render(parser);
+    else if (name == "playlist")
+      result = bench_playlist(parser);
+    else if (name == "palette")
+      result = bench_palette(parser);
+    else if (name == "playlist-memory")
+      result = bench_playlist_memory(parser);
+    else if (name == "playlist-sort")
+      result = bench_playlist_sort(parser);
+    else
+      throw std::runtime_error(fmt::format("unknown benchmark: {}", name));
+
+    auto output = option(parser, "output", "");
+    if (output.empty()) {
+      fmt::print("{}\n", result.dump(2));
+    } else {
+      std::ofstream file(output);
+      file << result.dump(2) << std::endl;
+    }
+    return 0;
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "Error: {}\n", e.what());
+    return 1;
+  }
+}
@@ -51,6 +51,10 @@ struct ConfigData {
     bool SpaceToPlayLast = false;
     bool operator==(const Recent_&) const = default;
   } Recent;
+  struct Library_ {
+    std::string Dirs;  // media directories listed by the files provider of the command palette, ';' separated
+    bool operator==(const Library_&) const = default;
+  } Library;
   bool operator==(const ConfigData&) const = default;
 };
 
@@ -0,0 +1,46 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ImPlay {
+// fzf-style fuzzy matching over a fixed set of items. Each item has a text and an optional detail, both
+// case-folded once when added; items that only match on their detail rank after those matching on their
+// text. Space-separated terms of a query must all match. The matches of the previous query are kept, so
+// extending it, or adding items, only rescans those and the new items.
+class FuzzyMatcher {
+ public:
+  void clear();
+  void reserve(size_t count);
+  void add(std::string_view text, std::string_view detail = {});
+  size_t size() const { return items.size(); }
+
+  // indices of the items matching query, best first, equal scores in the order the items were added
+  const std::vector<uint32_t> &match(std::string_view query);
+
+ private:
+  struct Field {
+    uint32_t offset, size;
+    uint64_t mask;  // characters present, see charBit
+  };
+  struct Item {
+    Field text, detail;
+  };
+
+  Field store(std::string_view str);
+  int score(const Field &field, const std::vector<std::string_view> &terms) const;  // INT_MIN if a term is missing
+
+  std::string buffer;  // case-folded texts, back to back
+  std::vector<Item> items;
+
+  std::string query;              // case-folded query of the last match
+  std::vector<uint32_t> matched;  // items matching it, ascending
+  size_t scanned = 0;             // items added before it, later ones are yet to be matched
+  std::vector<uint64_t> scored;  // sort keys of the matches, the item index in the low bits
+  std::vector<uint32_t> result;
+};
+}  // namespace ImPlay
@@ -6,6 +6,7 @@
 
 namespace ImGui {
 bool IsAnyKeyPressed();
+bool IsDrawListOnly(ImDrawData* drawData, ImDrawList* drawList);
 void HalignCenter(const char* text);
 void TextCentered(const char* text, bool disabled = false);
 void TextEllipsis(const char* text, float maxWidth = 0);
@@ -0,0 +1,137 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ImPlay::Media {
+enum class Type { None, Video, Audio, Image, Subtitle };
+
+namespace detail {
+struct Extension {
+  std::string_view name;
+  Type type;
+};
+
+constexpr Extension v(std::string_view name) { return {name, Type::Video}; }
+constexpr Extension a(std::string_view name) { return {name, Type::Audio}; }
+constexpr Extension i(std::string_view name) { return {name, Type::Image}; }
+constexpr Extension s(std::string_view name) { return {name, Type::Subtitle}; }
+
+// clang-format off
+inline constexpr Extension extensions[] = {
+    v("yuv"), v("y4m"), v("m2ts"), v("m2t"), v("mts"), v("mtv"), v("ts"), v("tsv"), v("tsa"), v("tts"), v("trp"),
+    v("mpeg"), v("mpg"), v("mpe"), v("mpeg2"), v("m1v"), v("m2v"), v("mp2v"), v("mpv"), v("mpv2"), v("mod"),
+    v("vob"), v("vro"), v("evob"), v("evo"), v("mpeg4"), v("m4v"), v("mp4"), v("mp4v"), v("mpg4"), v("h264"),
+    v("avc"), v("x264"), v("264"), v("hevc"), v("h265"), v("x265"), v("265"), v("ogv"), v("ogm"), v("ogx"),
+    v("mkv"), v("mk3d"), v("webm"), v("avi"), v("vfw"), v("divx"), v("3iv"), v("xvid"), v("nut"), v("flic"),
+    v("fli"), v("flc"), v("nsv"), v("gxf"), v("mxf"), v("wm"), v("wmv"), v("asf"), v("dvr-ms"), v("dvr"),
+    v("wtv"), v("dv"), v("hdv"), v("flv"), v("f4v"), v("qt"), v("mov"), v("hdmov"), v("rm"), v("rmvb"),
+    v("3gpp"), v("3gp"), v("3gp2"), v("3g2"),
+
+    a("ac3"), a("a52"), a("eac3"), a("mlp"), a("dts"), a("dts-hd"), a("dtshd"), a("true-hd"), a("thd"),
+    a("truehd"), a("thd+ac3"), a("tta"), a("pcm"), a("wav"), a("aiff"), a("aif"), a("aifc"), a("amr"), a("awb"),
+    a("au"), a("snd"), a("lpcm"), a("ape"), a("wv"), a("shn"), a("adts"), a("adt"), a("mpa"), a("m1a"), a("m2a"),
+    a("mp1"), a("mp2"), a("mp3"), a("m4a"), a("aac"), a("flac"), a("oga"), a("ogg"), a("opus"), a("spx"),
+    a("mka"), a("weba"), a("wma"), a("f4a"), a("ra"), a("ram"), a("3ga"), a("3ga2"), a("ay"), a("gbs"), a("gym"),
+    a("hes"), a("kss"), a("nsf"), a("nsfe"), a("sap"), a("spc"), a("vgm"), a("vgz"), a("m3u"), a("m3u8"),
+    a("pls"), a("cue"),
+
+    i("jpg"), i("bmp"), i("png"), i("gif"), i("webp"),
+
+    s("srt"), s("ass"), s("idx"), s("sub"), s("sup"), s("ttxt"), s("txt"), s("ssa"), s("smi"), s("mks"),
+};
+// clang-format on
+
+inline constexpr size_t MAX_LENGTH = 7;
+inline constexpr size_t COUNT = std::size(extensions);
+inline constexpr size_t BUCKETS = 64;
+inline constexpr size_t SLOTS = 256;
+
+constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (char c : s) h = (h ^ (uint8_t)c) * 16777619u;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+// Two-level perfect hash (hash and displace): keys are split into buckets by their plain hash, then each
+// bucket, largest first, gets the first seed that places all of its keys into free slots.
+struct Table {
+  std::array<uint32_t, BUCKETS> seeds{};
+  std::array<int16_t, SLOTS> slots{};
+};
+
+constexpr Table buildTable() {
+  Table table;
+  for (auto &slot : table.slots) slot = -1;
+  std::array<size_t, BUCKETS> sizes{};
+  for (auto &ext : extensions) sizes[hash(ext.name, 0) % BUCKETS]++;
+
+  for (size_t size = COUNT; size > 0; size--) {
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+      if (sizes[bucket] != size) continue;
+      for (uint32_t seed = 1;; seed++) {
+        if (seed > 1000000) throw "no perfect hash for the media extensions";
+        std::array<int16_t, SLOTS> slots = table.slots;
+        bool ok = true;
+        for (size_t i = 0; i < COUNT && ok; i++) {
+          if (hash(extensions[i].name, 0) % BUCKETS != bucket) continue;
+          auto &slot = slots[hash(extensions[i].name, seed) % SLOTS];
+          if (slot >= 0) ok = false;
+          slot = (int16_t)i;
+        }
+        if (!ok) continue;
+        table.slots = slots;
+        table.seeds[bucket] = seed;
+        break;
+      }
+    }
+  }
+  return table;
+}
+
+inline constexpr Table table = buildTable();
+}  // namespace detail
+
+// Type of a file extension without the dot, case-insensitive. Works on narrow and wide (Windows) paths.
+template <typename C>
+constexpr Type fromExtension(std::basic_string_view<C> ext) {
+  if (ext.empty() || ext.size() > detail::MAX_LENGTH) return Type::None;
+  char buf[detail::MAX_LENGTH];
+  for (size_t i = 0; i < ext.size(); i++) {
+    auto c = (std::make_unsigned_t<C>)ext[i];
+    if (c == 0 || c >= 128) return Type::None;
+    buf[i] = c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : (char)c;
+  }
+  std::string_view key(buf, ext.size());
+  uint32_t seed = detail::table.seeds[detail::hash(key, 0) % detail::BUCKETS];
+  int16_t index = detail::table.slots[detail::hash(key, seed) % detail::SLOTS];
+  if (index < 0 || detail::extensions[index].name != key) return Type::None;
+  return detail::extensions[index].type;
+}
+constexpr Type fromExtension(std::string_view ext) { return fromExtension<char>(ext); }
+
+static_assert(fromExtension("MKV") == Type::Video && fromExtension("flac") == Type::Audio);
+static_assert(fromExtension("WebP") == Type::Image && fromExtension("srt") == Type::Subtitle);
+static_assert(fromExtension("iso") == Type::None && fromExtension("mkvv") == Type::None);
+
+// Type by the leading bytes of a file, for files with no or an unknown extension.
+Type sniff(const uint8_t *data, size_t size);
+Type sniff(const std::filesystem::path &path);
+
+// By extension, falling back to the file's content if sniff is set and the extension is unknown.
+Type classify(const std::filesystem::path &path, bool sniff = false);
+inline bool isMedia(Type type) { return type == Type::Video || type == Type::Audio || type == Type::Image; }
+
+std::string extensions(Type type, const char *separator = ",");
+}  // namespace ImPlay::Media
@@ -0,0 +1,42 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ImPlay {
+// Natural sort on precomputed keys: each string is turned once into a key that compares with memcmp, so
+// the sort does no parsing or case folding per comparison. The order is the one of strnatcasecmp, except
+// that numbers with leading zeros compare by value and non-ASCII bytes sort after ASCII ones.
+class NaturalSort {
+ public:
+  static constexpr size_t PARALLEL_THRESHOLD = 16384;  // smaller lists are sorted on the calling thread
+
+  void reserve(size_t count);
+  void add(std::string_view str);
+  size_t size() const { return keys.size(); }
+
+  // indices of the added strings in sorted order, equal keys keep the order they were added in
+  std::vector<uint32_t> sort(bool reverse = false, bool parallel = true) const;
+
+  // Arguments of the playlist-move commands that rearrange a list into order, keeping the longest run of
+  // entries that are already in order in place. nullopt if that takes more than limit moves.
+  static std::optional<std::vector<std::pair<size_t, size_t>>> moves(const std::vector<uint32_t> &order,
+                                                                     size_t limit);
+
+ private:
+  struct Key {
+    uint32_t offset, size;
+  };
+
+  bool less(uint32_t a, uint32_t b) const;
+
+  std::string buffer;  // all keys, back to back
+  std::vector<Key> keys;
+};
+}  // namespace ImPlay
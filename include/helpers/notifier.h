@@ -0,0 +1,36 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if !defined(__linux__) && !defined(_WIN32)
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace ImPlay {
+// Coalescing wakeup for a single waiting thread. notify() is lock-free and only enters the kernel
+// when the waiter is actually sleeping, so it is safe to call from mpv's internal threads.
+class Notifier {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  void notify();
+  void wait();
+  bool wait_until(Clock::time_point deadline);  // false on timeout
+
+ private:
+  enum : uint32_t { IDLE, NOTIFIED, SLEEPING };
+
+  bool sleep(const Clock::time_point *deadline);
+  void wake();
+
+  std::atomic_uint32_t state = IDLE;
+#if !defined(__linux__) && !defined(_WIN32)
+  std::mutex lock;
+  std::condition_variable cond;
+#endif
+};
+}  // namespace ImPlay
@@ -0,0 +1,45 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <memory>
+#ifndef __cpp_lib_atomic_shared_ptr
+#include <mutex>
+#endif
+
+namespace ImPlay {
+// Immutable value published by one thread and read by others. Readers keep the snapshot they loaded alive
+// for as long as they hold it, writers build a new value and swap it in as a whole.
+template <typename T>
+class Snapshot {
+ public:
+  Snapshot() : value(std::make_shared<const T>()) {}
+
+  std::shared_ptr<const T> load() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+    return value.load(std::memory_order_acquire);
+#else
+    std::lock_guard<std::mutex> guard(lock);
+    return value;
+#endif
+  }
+
+  void store(std::shared_ptr<const T> next) {
+#ifdef __cpp_lib_atomic_shared_ptr
+    value.store(std::move(next), std::memory_order_release);
+#else
+    std::lock_guard<std::mutex> guard(lock);
+    value.swap(next);
+#endif
+  }
+
+ private:
+#ifdef __cpp_lib_atomic_shared_ptr
+  std::atomic<std::shared_ptr<const T>> value;
+#else
+  mutable std::mutex lock;
+  std::shared_ptr<const T> value;
+#endif
+};
+}  // namespace ImPlay
@@ -0,0 +1,86 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ImPlay {
+class Metrics {
+ public:
+  struct Pacing {
+    int64_t interval = 0;     // measured vsync interval, in microseconds
+    uint64_t frames = 0;      // video frames presented
+    uint64_t onTime = 0;      // frames presented on the vsync closest to their target time
+    uint64_t missed = 0;      // vsyncs lost by frames presented after their target time
+    uint64_t duplicated = 0;  // extra vsyncs frames stayed on screen, compared to their duration
+
+    void reset() { frames = onTime = missed = duplicated = 0; }
+  };
+
+  // UI frames rendered vs. skipped by damage tracking, direct ones had no overlay to composite
+  struct Frames {
+    uint64_t rendered = 0;
+    uint64_t skipped = 0;
+    uint64_t direct = 0;
+
+    void reset() { rendered = skipped = direct = 0; }
+  };
+
+  // audio chain reinitializations, and those that happened while an equalizer slider was dragged
+  struct Audio {
+    uint64_t reconfigs = 0;
+    uint64_t dragReconfigs = 0;
+    int64_t dragTime = 0;  // microseconds an equalizer slider was held
+
+    void reset() { reconfigs = dragReconfigs = dragTime = 0; }
+  };
+
+  enum Phase {
+    PHASE_EVENTS,      // glfwPollEvents, only measured when the loop did not sleep
+    PHASE_MPV_EVENTS,  // Mpv::processEvents
+    PHASE_NEW_FRAME,   // ImGui::NewFrame and draw()
+    PHASE_RENDER,      // ImGui::Render
+    PHASE_COMPOSITE,   // ImGui_ImplOpenGL3_RenderDrawData or the direct video blit
+    PHASE_SWAP,        // SwapBuffers
+    PHASE_FRAME,       // the whole UI frame
+    PHASE_VIDEO,       // renderVideo, on the video thread
+    PHASE_SYNC,        // glFinish, when sync objects are not supported; fence waits are queued on the GPU
+    PHASE_COUNT,
+  };
+
+  // rolling window of the latest samples in microseconds, can be fed from any thread
+  struct Histogram {
+    static constexpr int SIZE = 512;
+
+    struct Summary {
+      int count = 0;
+      int64_t p50 = 0, p95 = 0, p99 = 0, max = 0;
+    };
+
+    void add(int64_t us);
+    Summary summary() const;
+    void reset() { count = 0; }
+
+    std::atomic_uint32_t samples[SIZE] = {};
+    std::atomic_uint32_t count = 0;
+  };
+
+  // records the lifetime of the probe into a phase histogram
+  struct Probe {
+    Probe(Metrics *metrics, Phase phase) : histogram(metrics->phases[phase]) {}
+    ~Probe();
+
+    Histogram &histogram;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  };
+
+  static const char *phaseName(Phase phase);
+
+  Pacing pacing;
+  Frames frames;
+  Audio audio;
+  Histogram phases[PHASE_COUNT];
+};
+}  // namespace ImPlay
@@ -4,10 +4,20 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 #include <functional>
 #include <filesystem>
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
+#include "metrics.h"
+#include "playlist.h"
+#include "helpers/snapshot.h"
 
 namespace ImPlay {
 typedef void *(*GLAddrLoadFunc)(const char *name);
@@ -19,33 +29,53 @@ class Mpv {
   using EventHandler = std::function<void(void *)>;
   using LogHandler = std::function<void(const char *, const char *, const char *)>;
   using Callback = std::function<void(Mpv *)>;
+  // completion of an asynchronous request, called on the thread running processEvents. data is the
+  // command's result (mpv_node *) or the property value in the requested format, only valid if error >= 0
+  using Reply = std::function<void(int error, void *data)>;
 
   void init(GLAddrLoadFunc load, int64_t wid = 0);
   void render(int w, int h, int fbo = 0, bool flip = true);
+  void freeRender();
   bool wantRender();
+  int64_t nextFrameTime();
   void reportSwap();
-  void waitEvent(double timeout = 0);
+  bool processEvents();
   void requestLog(const char *level, LogHandler handler);
   int loadConfig(const char *path);
 
-  bool playing() { return playlistPlayingPos != -1; }
-  bool allowDrag() { return windowDragging && !fullscreen; }
+  int64_t time() { return mpv_get_time_us(mpv); }
 
   Callback &wakeupCb() { return wakeupCb_; }
   Callback &updateCb() { return updateCb_; }
 
-  inline int command(std::string args) { return mpv_command_string(mpv, args.c_str()); }
-  inline int command(const char *args) { return mpv_command_string(mpv, args); }
-  inline int command(const char *args[]) { return mpv_command_async(mpv, 0, args); }
-  int commandv(const char *arg, ...);
+  // Commands and property writes are sent with libmpv's asynchronous API, so the caller never waits for
+  // mpv's core. They run in submission order, and reply is called once mpv replied.
+  void command(std::string args, const Reply &reply = nullptr);
+  void command(const char *args[], const Reply &reply = nullptr);
+  void commandv(const char *arg, ...);
 
+  // Asynchronous property reads, the typed variant does not call the handler if the property is unavailable.
+  void propertyAsync(const char *name, mpv_format format, const Reply &reply);
+  template <typename T, mpv_format format>
+  void propertyAsync(const char *name, const std::function<void(T data)> &handler) {
+    propertyAsync(name, format, [=](int error, void *data) {
+      if (error >= 0) handler(*(T *)data);
+    });
+  }
+
+  // latency of requests by command or property name, from submission to completion
+  std::vector<std::pair<std::string, Metrics::Histogram::Summary>> latency();
+  void resetLatency();
+  uint64_t commandCount() const { return requestCount; }  // commands and property writes submitted
+
+  // synchronous reads, avoid them on the UI thread outside of initialization
   std::string property(const char *name) {
     char *data = mpv_get_property_string(mpv, name);
     std::string ret = data ? data : "";
     mpv_free(data);
     return ret;
   }
-  int property(const char *name, const char *data) { return mpv_set_property_string(mpv, name, data); }
+  void property(const char *name, const char *data) { setProperty(name, MPV_FORMAT_STRING, &data); }
   template <typename T, mpv_format format>
   T property(const char *name) {
     T data{0};
@@ -53,21 +83,30 @@ class Mpv {
     return data;
   }
   template <typename T, mpv_format format>
-  int property(const char *name, T data) {
-    return mpv_set_property(mpv, name, format, static_cast<void *>(&data));
+  void property(const char *name, T data) {
+    setProperty(name, format, static_cast<void *>(&data));
   }
 
+  // Writes from continuous controls like sliders: only the latest value of each property is kept and
+  // written by processEvents, at most once per interval (once per call by default). flushDeferred writes
+  // the property right away, call it when the control is released.
+  void propertyDeferred(const char *name, std::string value);
+  void flushDeferred(const char *name);
+  void setDeferInterval(int64_t us) { deferInterval = us; }
+
   int option(const char *name, const char *data) { return mpv_set_option_string(mpv, name, data); }
   template <typename T, mpv_format format>
   int option(const char *name, T data) {
     return mpv_set_option(mpv, name, format, static_cast<void *>(&data));
   }
 
-  void observeEvent(mpv_event_id event, const EventHandler &handler) { events.emplace_back(event, handler); }
+  void observeEvent(mpv_event_id event, const EventHandler &handler) {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    events[event].push_back(handler);
+  }
   template <typename T, mpv_format format>
   void observeProperty(const std::string &name, const std::function<void(T data)> &handler) {
-    propertyEvents.emplace_back(name, format, [=](void *data) { handler(*(T *)data); });
-    mpv_observe_property(mpv, 0, name.c_str(), format);
+    observeProperty(name, format, [=](void *data) { handler(*(T *)data); }, nullptr);
   }
 
   struct TrackItem {
@@ -75,21 +114,17 @@ class Mpv {
     std::string type;
     std::string title;
     std::string lang;
-    bool selected;
-  };
-
-  struct PlayItem {
-    int64_t id = -1;
-    std::string title;
-    std::filesystem::path path;
+    bool selected = false;
 
-    inline std::string filename() const { return path.filename().string(); }
+    bool operator==(const TrackItem &) const = default;
   };
 
   struct ChapterItem {
     int64_t id = -1;
     std::string title;
-    double time;
+    double time = 0;
+
+    bool operator==(const ChapterItem &) const = default;
   };
 
   struct BindingItem {
@@ -106,30 +141,61 @@ class Mpv {
     std::string description;
   };
 
-  // cached mpv properties
-  std::vector<PlayItem> playlist;
-  std::vector<ChapterItem> chapters;
-  std::vector<TrackItem> tracks;
-  std::vector<AudioDevice> audioDevices;
-  std::vector<BindingItem> bindings;
-  std::vector<std::string> profiles;
-  std::string aid, vid, sid, sid2, audioDevice, cursorAutohide;
-  int64_t chapter, volume, playlistPos, playlistPlayingPos, timePos;
-  int64_t brightness, contrast, saturation, gamma, hue;
-  double audioDelay, subDelay, subScale;
-  bool pause, mute, fullscreen, sidv, sidv2, forceWindow, ontop;
-  bool keepaspect, keepaspectWindow, windowDragging, autoResize;
+  template <typename T>
+  using List = std::shared_ptr<const std::vector<T>>;
+
+  // Cached mpv properties, built on the event thread. A published state is never modified, lists are
+  // shared between consecutive states until the property they mirror changes.
+  struct State {
+    uint64_t version = 0;
+    std::shared_ptr<const Playlist> playlist = std::make_shared<const Playlist>();
+    List<ChapterItem> chapters = std::make_shared<const std::vector<ChapterItem>>();
+    List<TrackItem> tracks = std::make_shared<const std::vector<TrackItem>>();
+    List<AudioDevice> audioDevices = std::make_shared<const std::vector<AudioDevice>>();
+    List<BindingItem> bindings = std::make_shared<const std::vector<BindingItem>>();
+    List<std::string> profiles = std::make_shared<const std::vector<std::string>>();
+    std::string aid, vid, sid, sid2, audioDevice, cursorAutohide;
+    int64_t chapter = -1, volume = 0, playlistPos = -1, playlistPlayingPos = -1, timePos = 0;
+    int64_t brightness = 0, contrast = 0, saturation = 0, gamma = 0, hue = 0;
+    double audioDelay = 0, subDelay = 0, subScale = 1;
+    bool pause = false, mute = false, fullscreen = false, sidv = false, sidv2 = false, forceWindow = false;
+    bool ontop = false, keepaspect = false, keepaspectWindow = false, windowDragging = false, autoResize = false;
+
+    bool playing() const { return playlistPlayingPos != -1; }
+    bool allowDrag() const { return windowDragging && !fullscreen; }
+  };
+
+  // latest published state, safe to hold across frames and threads
+  std::shared_ptr<const State> state() const { return state_.load(); }
 
  private:
+  using StateUpdater = std::function<void(State &, void *)>;
+
   void eventLoop();
+  void stateLoop();
+  void observeProperty(const std::string &name, mpv_format format, const EventHandler &handler,
+                       const StateUpdater &update);
+  template <typename T, mpv_format format>
+  void observeState(const std::string &name, const std::function<void(State &, T data)> &update) {
+    observeProperty(name, format, nullptr, [=](State &state, void *data) { update(state, *(T *)data); });
+  }
+  void queueProperty(size_t index, mpv_format format, void *data);
+  void queueEvent(mpv_event *event);
+  void queueReply(const Reply &reply, int error, mpv_node &value, mpv_format format);
+
+  uint64_t addRequest(std::string name, mpv_format format, const Reply &reply, int parts = 1);
+  void completeRequest(uint64_t id, int error, mpv_format format, void *data);
+  void submit(std::string name, const std::vector<std::vector<std::string>> &commands, const Reply &reply);
+  void setProperty(const char *name, mpv_format format, void *data);
+  void record(std::string_view name, int64_t submitted);
 
   void observeProperties();
-  void initPlaylist(mpv_node &node);
-  void initChapters(mpv_node &node);
-  void initTracks(mpv_node &node);
-  void initAudioDevices(mpv_node &node);
-  void initBindings(mpv_node &node);
-  void initProfiles(const char *payload);
+  static void initPlaylist(State &state, mpv_node &node);
+  static void initChapters(State &state, mpv_node &node);
+  static void initTracks(State &state, mpv_node &node);
+  static void initAudioDevices(State &state, mpv_node &node);
+  static void initBindings(State &state, mpv_node &node);
+  static void initProfiles(State &state, const char *payload);
 
   int64_t wid = 0;
   mpv_handle *main = nullptr;
@@ -138,7 +204,64 @@ class Mpv {
   LogHandler logHandler = nullptr;
   Callback wakeupCb_, updateCb_;
 
-  std::vector<std::tuple<mpv_event_id, EventHandler>> events;
-  std::vector<std::tuple<std::string, mpv_format, EventHandler>> propertyEvents;
+  Snapshot<State> state_;
+  uint64_t stateVersion = 0;  // last version seen by processEvents
+  std::thread stateThread;
+  std::atomic_bool stateShutdown = false;
+
+  // Observed properties are indexed by reply_userdata - 1. Properties with an updater are applied to the
+  // state on the event thread, the others are queued for their handler on the UI thread.
+  struct PropertyEvent {
+    std::string name;
+    mpv_format format;
+    EventHandler handler;
+    StateUpdater update;
+    int queued = -1;  // index of the pending entry holding the latest value, -1 if none can be reused
+  };
+
+  // Work for the UI thread. Changes of the same property are merged into one entry with the latest value
+  // until an event is queued after it, so handlers see changes and events in the order mpv sent them.
+  struct Pending {
+    mpv_event_id event;
+    size_t property = 0;
+    mpv_node value{};  // property value, client message args, log message prefix/level/text or reply data
+    Reply reply = nullptr;  // set for command and property replies
+    mpv_format format = MPV_FORMAT_NONE;
+    int error = 0;
+  };
+
+  // An asynchronous request waiting for its reply event, keyed by its reply_userdata. A command string
+  // may be sent as several commands sharing the id, the reply is queued once all of them replied.
+  struct PendingRequest {
+    std::string name;   // for the latency histograms
+    mpv_format format;  // of the data passed to reply
+    Reply reply;
+    int64_t submitted;
+    int parts = 1;  // replies still expected
+    int error = 0;  // first error among them
+  };
+
+  std::mutex pendingLock;
+  std::vector<Pending> pending;
+  std::vector<size_t> openProperties;
+  std::unordered_map<int, std::vector<EventHandler>> events;
+  std::deque<PropertyEvent> propertyEvents;
+  std::unordered_map<uint64_t, PendingRequest> pendingRequests;
+  uint64_t nextRequestId = 1;
+
+  std::atomic_uint64_t requestCount = 0;
+
+  // deferred property writes, only touched by the UI thread
+  struct Deferred {
+    std::string value, sent;
+    bool dirty = false;
+  };
+  std::map<std::string, Deferred, std::less<>> deferred;
+  int64_t deferInterval = 0;
+  int64_t deferFlushed = 0;
+  void flushDeferred();
+
+  std::mutex latencyLock;
+  std::map<std::string, Metrics::Histogram, std::less<>> latencies;
 };
 }  // namespace ImPlay
\ No newline at end of file
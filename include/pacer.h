@@ -0,0 +1,35 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "metrics.h"
+
+namespace ImPlay {
+// Schedules video frames to the vsync closest to their target time.
+// All times are in microseconds, on mpv's clock (mpv_get_time_us).
+class Pacer {
+ public:
+  explicit Pacer(Metrics::Pacing &stats) : stats(stats) {}
+
+  void setRefreshRate(int hz);
+
+  int64_t renderTime(int64_t target) const;
+  bool due(int64_t target, int64_t now) const;
+  int64_t delay(int64_t target, int64_t now) const;
+
+  void swapped(int64_t now, bool vsync);
+  void presented(int64_t target, int64_t now);
+
+ private:
+  int64_t nextVsync(int64_t now) const;
+
+  Metrics::Pacing &stats;
+  int64_t nominal = 16667;
+  std::atomic<int64_t> interval = 16667;
+  int64_t lastSwap = 0;
+  bool vsync = false;
+  int64_t lastTarget = 0, lastPresent = 0;
+};
+}  // namespace ImPlay
@@ -5,7 +5,9 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <thread>
 #ifdef IMGUI_IMPL_OPENGL_ES3
 #include <GLES3/gl3.h>
 #else
@@ -13,6 +15,9 @@
 #endif
 #include "mpv.h"
 #include "config.h"
+#include "pacer.h"
+#include "scanner.h"
+#include "metrics.h"
 #include "views/view.h"
 #include "views/about.h"
 #include "views/debug.h"
@@ -21,7 +26,11 @@
 #include "views/context_menu.h"
 #include "views/command_palette.h"
 #include "helpers/imgui.h"
+#include "helpers/media.h"
+#include "helpers/natsort.h"
 #include "helpers/nfd.h"
+#include "helpers/notifier.h"
+#include "helpers/snapshot.h"
 #include "helpers/utils.h"
 
 #define PLAYER_NAME "ImPlay"
@@ -43,17 +52,29 @@ class Player {
 
   void loadFonts();
   void render();
-  void renderVideo();
+  void startVideo();
+  void stopVideo();
+  void invalidate(int frames = 2) { dirtyFrames = std::max(dirtyFrames, frames); }
+  double videoDelay();
+
+  virtual void wakeup() = 0;
 
   void onCursorEvent(double x, double y);
   void onScrollEvent(double x, double y);
-  void onKeyEvent(std::string name);
-  void onKeyDownEvent(std::string name);
-  void onKeyUpEvent(std::string name);
+  void onKeyEvent(const char *name);
+  void onKeyDownEvent(const char *name);
+  void onKeyUpEvent(const char *name);
+  void flushInput();
   void onDropEvent(int count, const char **paths);
+  void updateScan();
+  void startScan(const std::vector<std::filesystem::path> &roots, const char *action);
+  void cancelScan();
 
   Config *config = nullptr;
   Mpv *mpv = nullptr;
+  Metrics metrics;
+  Pacer pacer{metrics.pacing};
+  Scanner scanner{[this]() { wakeup(); }};  // must be stopped before the window goes away
   int width = 1280, height = 720;
 
  private:
@@ -63,6 +84,14 @@ class Player {
 
   void draw();
   void drawVideo();
+  void renderVideo();
+  void exitVideo();
+  int64_t videoRenderTime();
+  bool videoQueued();
+  void acquireVideoFrame();
+  void blitVideo();
+  void fenceSync(GLsync &sync);
+  void waitSync(GLsync &sync);
   void execute(int n_args, const char **args_);
 
   void openFileDlg(NFD::Filters filters, bool append = false);
@@ -80,16 +109,18 @@ class Player {
   void messageBox(std::string title, std::string msg);
 
   void load(std::vector<std::filesystem::path> files, bool append = false, bool disk = false);
-  bool isMediaFile(std::string file);
-  bool isSubtitleFile(std::string file);
+  void loadList(const std::vector<std::string> &paths, const char *action,
+                const std::vector<std::string_view> &titles = {});
 
   virtual int64_t GetWid() { return 0; }
+  virtual GLuint GetFramebuffer() { return 0; }
   virtual GLAddrLoadFunc GetGLAddrFunc() = 0;
   virtual std::string GetClipboardString() = 0;
   virtual void GetMonitorSize(int *w, int *h) = 0;
   virtual int GetMonitorRefreshRate() = 0;
   virtual void GetFramebufferSize(int *w, int *h) = 0;
   virtual void MakeContextCurrent() = 0;
+  virtual void MakeVideoContextCurrent() = 0;
   virtual void DeleteContext() = 0;
   virtual void SwapBuffers() = 0;
   virtual void SetSwapInterval(int interval) = 0;
@@ -108,10 +139,58 @@ class Player {
   virtual void SetWindowFullscreen(bool fs) = 0;
   virtual void SetWindowShouldClose(bool c) = 0;
 
+  struct VideoTarget {
+    GLuint fbo = 0, tex = 0;
+    GLsync fence = nullptr;
+    int width = 0, height = 0;
+    std::atomic<int64_t> target = 0;  // mpv time the frame should be presented at, 0 for asap
+
+    void alloc(int w, int h);
+    void destroy();
+  };
+
+  // Triple-buffered video targets: the video thread renders into videoWrite and publishes it as videoReady,
+  // the UI thread swaps the latest ready target into videoRead before compositing. Storage is only
+  // reallocated when the framebuffer size changes. Textures are shared between the UI and video contexts,
+  // the framebuffers belong to the video context; each hand-over is guarded by a fence.
+  static constexpr int VIDEO_FRESH = 1 << 8;
+  VideoTarget videoTargets[3];
+  int videoWrite = 0, videoRead = 1;
+  std::atomic_int videoReady = 2;
+  bool videoValid = false;
+  struct Surface {
+    int width = 0, height = 0;
+  };
+  Snapshot<Surface> surface;  // framebuffer size, published by the UI thread for the video thread
+  std::thread videoThread;
+  std::atomic_bool videoShutdown = false;
+  GLuint blitFbo = 0;  // UI context's read framebuffer for the direct video path
+  int dirtyFrames = 2;  // frames to render before the presented image can be reused
+  bool videoPresenting = false;
+  int64_t videoNextTarget = 0;
+
+  Notifier videoNotifier;
+
+  // mouse input is sent to mpv once per UI frame: motion collapses to the latest position, scroll deltas
+  // accumulate into whole wheel steps; key events flush it first to keep the order
+  struct Input {
+    bool moved = false;
+    int x = 0, y = 0;
+    double scrollX = 0, scrollY = 0;
+  };
+  Input input;
+
+  // folder being loaded by the scanner
+  struct Scan {
+    bool active = false;
+    const char *action = "replace";             // loadlist action of the first batch
+    size_t files = 0;                           // files added to the playlist
+    std::vector<std::filesystem::path> queued;  // appended while scanning, scanned next
+  };
+  Scan scan;
+
   bool idle = true;
-  GLuint fbo = 0, tex = 0;
   ImTextureID logoTexture = 0;
-  std::mutex contextLock;
 
   bool m_openURL = false;
   bool m_dialog = false;
@@ -125,52 +204,18 @@ class Player {
   Views::ContextMenu *contextMenu;
   Views::CommandPalette *commandPalette;
 
-  const std::vector<std::string> videoTypes = {
-      "yuv", "y4m",   "m2ts", "m2t",   "mts",  "mtv",  "ts",   "tsv",    "tsa",  "tts",  "trp",  "mpeg", "mpg",
-      "mpe", "mpeg2", "m1v",  "m2v",   "mp2v", "mpv",  "mpv2", "mod",    "vob",  "vro",  "evob", "evo",  "mpeg4",
-      "m4v", "mp4",   "mp4v", "mpg4",  "h264", "avc",  "x264", "264",    "hevc", "h265", "x265", "265",  "ogv",
-      "ogm", "ogx",   "mkv",  "mk3d",  "webm", "avi",  "vfw",  "divx",   "3iv",  "xvid", "nut",  "flic", "fli",
-      "flc", "nsv",   "gxf",  "mxf",   "wm",   "wmv",  "asf",  "dvr-ms", "dvr",  "wtv",  "dv",   "hdv",  "flv",
-      "f4v", "qt",    "mov",  "hdmov", "rm",   "rmvb", "3gpp", "3gp",    "3gp2", "3g2"};
-  const std::vector<std::string> audioTypes = {
-      "ac3", "a52",  "eac3", "mlp",  "dts", "dts-hd", "dtshd", "true-hd", "thd",  "truehd", "thd+ac3", "tta", "pcm",
-      "wav", "aiff", "aif",  "aifc", "amr", "awb",    "au",    "snd",     "lpcm", "ape",    "wv",      "shn", "adts",
-      "adt", "mpa",  "m1a",  "m2a",  "mp1", "mp2",    "mp3",   "m4a",     "aac",  "flac",   "oga",     "ogg", "opus",
-      "spx", "mka",  "weba", "wma",  "f4a", "ra",     "ram",   "3ga",     "3ga2", "ay",     "gbs",     "gym", "hes",
-      "kss", "nsf",  "nsfe", "sap",  "spc", "vgm",    "vgz",   "m3u",     "m3u8", "pls",    "cue"};
-  const std::vector<std::string> imageTypes = {"jpg", "bmp", "png", "gif", "webp"};
-  const std::vector<std::string> subtitleTypes = {"srt",  "ass", "idx", "sub", "sup",
-                                                  "ttxt", "txt", "ssa", "smi", "mks"};
+  static constexpr size_t MAX_SORT_MOVES = 256;  // sorts needing more playlist-move commands reload the list
 
   const std::vector<std::pair<std::string, std::string>> mediaFilters = {
-      {"Videos Files", fmt::format("{}", join(videoTypes, ","))},
-      {"Audio Files", fmt::format("{}", join(audioTypes, ","))},
-      {"Image Files", fmt::format("{}", join(imageTypes, ","))},
+      {"Videos Files", Media::extensions(Media::Type::Video)},
+      {"Audio Files", Media::extensions(Media::Type::Audio)},
+      {"Image Files", Media::extensions(Media::Type::Image)},
   };
   const std::vector<std::pair<std::string, std::string>> subtitleFilters = {
-      {"Subtitle Files", fmt::format("{}", join(subtitleTypes, ","))},
+      {"Subtitle Files", Media::extensions(Media::Type::Subtitle)},
   };
   const std::vector<std::pair<std::string, std::string>> isoFilters = {
       {"ISO Image Files", "iso"},
   };
-
-  struct ContextGuard {
-   public:
-    inline ContextGuard(Player *p) : p(p) {
-      p->contextLock.lock();
-      p->MakeContextCurrent();
-    }
-    inline ~ContextGuard() {
-      p->DeleteContext();
-      p->contextLock.unlock();
-    }
-
-    // Disable copy from lvalue.
-    ContextGuard(const ContextGuard &) = delete;
-    ContextGuard &operator=(const ContextGuard &) = delete;
-
-   private:
-    Player *p;
-  };
 };
 }  // namespace ImPlay
\ No newline at end of file
@@ -0,0 +1,114 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ImPlay {
+// Immutable playlist in struct-of-arrays form. Strings live in an append-only arena that consecutive
+// playlists share, directories are interned so entries of the same folder only store their file name.
+class Playlist {
+ public:
+  // a view of one entry, valid as long as the playlist it came from
+  struct Item {
+    int64_t id = -1;       // position in the playlist
+    int64_t entryId = -1;  // mpv's playlist entry id, stable across moves
+    std::string_view title;
+    std::string_view dir;   // including the trailing separator, empty for bare names
+    std::string_view name;  // file name, or the whole filename if it has no separator
+
+    std::string path() const { return std::string(dir).append(name); }
+    std::string filename() const { return std::string(name); }
+  };
+
+  // input for build(), strings only need to stay valid during the call
+  struct Entry {
+    int64_t entryId = -1;
+    std::string_view title;
+    std::string_view filename;
+  };
+
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Item;
+
+    iterator(const Playlist *list, size_t i) : list(list), i(i) {}
+    Item operator*() const { return (*list)[i]; }
+    iterator &operator++() {
+      i++;
+      return *this;
+    }
+    bool operator==(const iterator &other) const { return i == other.i; }
+
+   private:
+    const Playlist *list;
+    size_t i;
+  };
+
+  // Builds a playlist from mpv's entries. Entries whose id is found in prev reuse its strings, the new
+  // playlist shares prev's arena unless most of it is garbage from removed entries or it is full. Never
+  // throws: in the unlikely case that the strings don't fit in a fresh arena, the rest are left empty.
+  static std::shared_ptr<const Playlist> build(const std::vector<Entry> &entries, const Playlist *prev);
+
+  size_t size() const { return entryIds.size(); }
+  bool empty() const { return entryIds.empty(); }
+  Item operator[](size_t i) const;
+  Item front() const { return (*this)[0]; }
+  Item back() const { return (*this)[size() - 1]; }
+  iterator begin() const { return {this, 0}; }
+  iterator end() const { return {this, size()}; }
+
+  int64_t entryId(size_t i) const { return entryIds[i]; }
+  std::string_view title(size_t i) const;
+  size_t memoryUsage() const;  // bytes held by this playlist, including the whole shared arena
+
+ private:
+  struct Str {
+    uint32_t offset = 0, size = 0;
+  };
+
+  static std::shared_ptr<Playlist> build(const std::vector<Entry> &entries, const Playlist *prev, bool reuse);
+
+  // Strings are addressed by a 32-bit offset into fixed-size chunks. Chunks are never moved or freed
+  // while the arena lives, so readers of published playlists don't race the writer appending to it.
+  // Strings longer than a chunk get a block of consecutive chunks of their own.
+  class Arena {
+   public:
+    Str add(std::string_view s);  // an empty string once the arena is full
+    Str intern(std::string_view s);
+    std::string_view get(Str s) const {
+      if (s.size == 0) return {};
+      return {chunks[s.offset >> CHUNK_BITS] + (s.offset & CHUNK_MASK), s.size};
+    }
+    size_t bytes() const { return used; }
+    size_t capacity() const { return ((size_t)used + CHUNK_MASK) & ~(size_t)CHUNK_MASK; }
+    bool full() const { return overflow; }  // some string did not fit
+
+   private:
+    static constexpr int CHUNK_BITS = 20;  // 1 MiB, 4 GiB in total
+    static constexpr uint32_t CHUNK_MASK = (1u << CHUNK_BITS) - 1;
+
+    std::array<char *, 4096> chunks{};
+    std::vector<std::unique_ptr<char[]>> blocks;  // owning the chunks, only touched by the writer
+    uint32_t used = 0;
+    bool overflow = false;
+    std::unordered_map<std::string_view, Str> interned;  // only touched by the writer
+  };
+
+  std::shared_ptr<Arena> arena;
+  std::vector<int64_t> entryIds;
+  std::vector<Str> dirs, names, titles;
+  size_t liveBytes = 0;  // string bytes referenced by this playlist, interned directories counted once
+};
+}  // namespace ImPlay
@@ -0,0 +1,49 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ImPlay {
+// Lists media files of folders in the background. Directories are read in parallel by a pool of workers,
+// while a collector walks the tree in natural sort order and hands out the files in that order as soon as
+// everything before them is known, so the first files are available long before a large folder is done.
+class Scanner {
+ public:
+  using Filter = std::function<bool(const std::filesystem::path &)>;
+  using Callback = std::function<void()>;
+
+  struct Progress {
+    size_t dirs = 0;   // directories read
+    size_t files = 0;  // files handed out so far
+    bool done = true;
+  };
+
+  explicit Scanner(const Callback &ready);
+  ~Scanner();  // cancels, the workers of the scan finish in the background
+
+  // Starts a scan, cancelling the running one without waiting for it. Roots are kept in the given order:
+  // files are reported as they are, directories are replaced by the files in them that pass the filter.
+  void start(const std::vector<std::filesystem::path> &roots, const Filter &filter);
+  void cancel();  // returns right away, ready is not called any more and the workers stop after their directory
+  void stop();    // cancels and waits for the workers
+
+  // moves the files found since the last call to out, in order; ready is called when there are new ones
+  void take(std::vector<std::string> &out);
+  Progress progress() const;
+
+ private:
+  // One scan, shared with its threads: a cancelled scan is left to finish the directory reads in progress
+  // on its own, so cancelling never waits for a slow disk.
+  struct Job;
+
+  void detach();
+
+  Callback ready;
+  std::shared_ptr<Job> job;
+};
+}  // namespace ImPlay
@@ -2,40 +2,84 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <map>
 #include <vector>
 #include "view.h"
+#include "helpers/fuzzy.h"
 
 namespace ImPlay::Views {
 class CommandPalette : public View {
  public:
-  CommandPalette(Config *config, Mpv *mpv);
+  CommandPalette(Config *config, Mpv *mpv, const std::function<void()> &wakeup);
+  ~CommandPalette() override;
 
   struct CommandItem {
     std::string title;
     std::string tooltip;
     std::string label;
     int64_t id;
-    std::function<void()> callback;
+    std::function<void(const CommandItem &)> callback;
   };
 
   void show(int n, const char **args);
   void draw() override;
+  bool pending() const { return shared->updated; }  // items arrived or a provider finished since the last draw
 
  private:
+  // Hands a batch of items to the palette. Returns false once the provider should stop: the palette was
+  // closed or opened for another provider.
+  using Sink = std::function<bool(std::vector<CommandItem> &&)>;
+  // Providers are called on the UI thread with the argument of the command, and return the task producing
+  // the items, which runs on a worker thread. Whatever the task reads must be captured by the provider.
+  using Task = std::function<void(const Sink &)>;
+  using Provider = std::function<Task(const char *)>;
+
+  static constexpr size_t BATCH_SIZE = 4096;  // items handed over at once by the large providers
+
   void drawInput();
   void drawList(float width);
   void match(const std::string &input);
+  void update();  // takes the items streamed in since the last frame
+  void cancel();  // stops the running task, without waiting for a slow one such as a scan of a NAS
+
+  Task files(bool refresh);
+
+  std::map<std::string, Provider> providers;
+  std::function<void()> wakeup;
+
+  // State shared with the worker thread. A cancelled task is left to finish on its own, so the thread keeps
+  // this alive and never touches the palette.
+  struct Shared {
+    std::mutex lock;
+    std::vector<CommandItem> received;  // guarded by lock
+    bool finished = false;              // guarded by lock, the task is done
+    uint64_t generation = 0;            // guarded by lock, changed to cancel the running task
+    std::atomic_bool updated = false;   // items arrived or the task finished since the last update
+
+    // the media files of the library dirs from the last complete scan, guarded by lock
+    struct Library {
+      std::string dirs;
+      std::shared_ptr<const std::vector<std::string>> files;
+    } library;
+  };
+  std::shared_ptr<Shared> shared = std::make_shared<Shared>();
 
-  std::map<std::string, std::function<void(const char*)>> providers;
   std::vector<char> buffer = std::vector<char>(1024, 0x00);
   std::vector<CommandItem> items;
-  std::vector<CommandItem> matches;
+  FuzzyMatcher matcher;           // over the titles and tooltips of items
+  std::vector<uint32_t> matches;  // indices into items, best match first
+  float labelWidth = 0;           // widest label of items
   int64_t pos = -1;
+  bool active = false;       // shown and not closed yet
+  bool loading = false;      // the task is still running
+  bool scrollToPos = false;  // the current item is not scrolled into view yet
   bool filtered = false;
   bool focusInput = false;
   bool justOpened = false;
 };
-}  // namespace ImPlay::Views
\ No newline at end of file
+}  // namespace ImPlay::Views
@@ -3,7 +3,10 @@
 
 #pragma once
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include "view.h"
 
@@ -28,14 +31,41 @@ class ContextMenu : public View {
   std::vector<Item> build();
 
  private:
-  void draw(std::vector<Item> items);
+  // what the menu built by build() depends on, it is only rebuilt when one of these changes
+  struct Inputs {
+    bool spaceToPlayLast = false, playing = false, paused = false, playlist = false, chapters = false;
+    bool watchLater = false;
+    std::string lang;
 
-  void drawPlaylist(std::vector<Mpv::PlayItem> items);
-  void drawChapterlist(std::vector<Mpv::ChapterItem> items);
-  void drawTracklist(const char *type, const char *prop, std::string pos);
+    bool operator==(const Inputs &) const = default;
+  };
+
+  // Titles of a submenu listing a mpv list, built once per list and language. The list is held so it can't
+  // be replaced by another one at the same address.
+  struct Titles {
+    std::shared_ptr<const void> source;
+    std::string lang;
+    std::vector<std::pair<size_t, std::string>> items;  // index into the list and title of the shown entries
+    std::string all;                                     // label of the entry showing the whole list, if any
+
+    bool stale(std::shared_ptr<const void> list);  // true and cleared if built for another list or language
+  };
+
+  void update();
+  void translate(std::vector<Item> &items);
+  void draw(const std::vector<Item> &items);
+
+  void drawPlaylist();
+  void drawChapterlist();
+  void drawTracklist(const char *type, const char *prop, const std::string &pos);
   void drawAudioDeviceList();
   void drawThemelist();
   void drawProfilelist();
   void drawRecentFiles();
+
+  Inputs inputs;
+  std::vector<Item> menu;  // built by build(), with the labels translated
+  Titles playlistTitles, chapterTitles, deviceTitles;
+  std::map<std::string, Titles> trackTitles;  // by track type
 };
 }  // namespace ImPlay::Views
\ No newline at end of file
@@ -7,11 +7,12 @@
 #include <string>
 #include <imgui.h>
 #include "view.h"
+#include "metrics.h"
 
 namespace ImPlay::Views {
 class Debug : public View {
  public:
-  Debug(Config *config, Mpv *mpv);
+  Debug(Config *config, Mpv *mpv, Metrics *metrics);
   ~Debug();
 
   void init();
@@ -59,6 +60,9 @@ class Debug : public View {
 
   void drawHeader();
   void drawConsole();
+  void drawPacing();
+  void drawTiming();
+  void drawLatency();
   void drawBindings();
   void drawCommands();
   void drawProperties(const char *title, std::vector<std::string> &props);
@@ -66,6 +70,10 @@ class Debug : public View {
 
   void initData();
 
+  Metrics *metrics = nullptr;
+  uint64_t commandCount = 0;  // sample of Mpv::commandCount for the commands per second rate
+  int64_t commandCountAt = 0;
+  double commandRate = 0;
   Console *console = nullptr;
   std::string version;
   std::string m_node = "Console";
@@ -1,12 +1,16 @@
 #pragma once
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 #include "view.h"
+#include "metrics.h"
 
 namespace ImPlay::Views {
 class Quickview : public View {
  public:
-  Quickview(Config *config, Mpv *mpv);
+  Quickview(Config *config, Mpv *mpv, Metrics *metrics);
 
   void show(const char *tab = nullptr);
   void draw() override;
@@ -17,6 +21,7 @@ class Quickview : public View {
     std::string name;
     int values[FREQ_COUNT];
     std::string toFilter(const char *name, int channels = 2);
+    std::string toCommand(int band, int channel);
   };
 
   struct Tab {
@@ -25,6 +30,16 @@ class Quickview : public View {
     std::function<void()> draw;
   };
 
+  // NUL-terminated display strings of a list, built once per list change so frames only draw them
+  struct Rows {
+    std::string text;
+    std::vector<uint32_t> offsets;
+
+    void clear();
+    void add(std::string_view str);
+    const char *operator[](size_t i) const { return text.data() + offsets[i]; }
+  };
+
   void drawWindow();
   void drawPopup();
   void drawTabBar();
@@ -41,7 +56,7 @@ class Quickview : public View {
   void toggleAudioEq();
   void selectAudioEq(int index);
   void setAudioEqValue(int freqIndex, float gain);
-  void updateAudioEqChannels();
+  void updateAudioEqChannels(mpv_node &node);
 
   void alignRight(const char *label);
   bool iconButton(const char *icon, const char *cmd, const char *tooltip = nullptr, bool sameline = true);
@@ -50,6 +65,12 @@ class Quickview : public View {
   void emptyLabel();
   void addTab(std::string name, std::string title, std::function<void()> draw) { tabs.push_back({name, title, draw}); }
 
+  std::shared_ptr<const Playlist> playlistSource;  // the playlist playlistTitles were built for
+  std::string playlistLang;                        // and the language of their fallback labels
+  Rows playlistTitles;
+  Mpv::List<Mpv::ChapterItem> chapterSource;
+  Rows chapterTitles, chapterTimes;
+
   bool winMode = false;
   bool tabSwitched = false;
   std::string curTab = "Video";
@@ -80,5 +101,12 @@ class Quickview : public View {
   int audioEqIndex = -1;
   int audioEqChannels = 2;
   bool audioEqEnabled = false;
+  // the @aeq filter is only rebuilt when the channel count changes, gains are changed with af-command
+  int audioEqBuilt = 0;                // channel count of the inserted filter, 0 if there is none
+  int audioEqBaked[FREQ_COUNT] = {0};  // gains in the filter string, the chain resets to them on reconfig
+  int audioEqLive[FREQ_COUNT] = {0};   // gains of the running filter
+  int64_t audioEqDragStart = 0;
+
+  Metrics *metrics = nullptr;
 };
 }  // namespace ImPlay::Views
\ No newline at end of file
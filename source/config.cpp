@@ -46,6 +46,7 @@ void Config::load() {
   inipp::get_value(ini.sections["debug"], "log-limit", Data.Debug.LogLimit);
   inipp::get_value(ini.sections["recent"], "limit", Data.Recent.Limit);
   inipp::get_value(ini.sections["recent"], "space-to-play-last", Data.Recent.SpaceToPlayLast);
+  inipp::get_value(ini.sections["library"], "dirs", Data.Library.Dirs);
 
   for (auto& [key, value] : ini.sections["recent"]) {
     if (key.find("file-") != 0 || value == "") continue;
@@ -86,6 +87,7 @@ void Config::save() {
   ini.sections["debug"]["log-limit"] = std::to_string(Data.Debug.LogLimit);
   ini.sections["recent"]["limit"] = std::to_string(Data.Recent.Limit);
   ini.sections["recent"]["space-to-play-last"] = fmt::format("{}", Data.Recent.SpaceToPlayLast);
+  ini.sections["library"]["dirs"] = Data.Library.Dirs;
 
   int index = 0;
   for (auto& file : recentFiles) {
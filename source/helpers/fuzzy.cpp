@@ -0,0 +1,191 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <numeric>
+#include "helpers/fuzzy.h"
+
+namespace ImPlay {
+namespace {
+// scoring of fzf's v1 algorithm
+constexpr int SCORE_MATCH = 16;
+constexpr int SCORE_GAP_START = -3;
+constexpr int SCORE_GAP_EXTENSION = -1;
+constexpr int BONUS_BOUNDARY = SCORE_MATCH / 2;
+constexpr int BONUS_NON_WORD = SCORE_MATCH / 2;
+constexpr int BONUS_NUMBER = BONUS_BOUNDARY + SCORE_GAP_EXTENSION;
+constexpr int BONUS_CONSECUTIVE = -(SCORE_GAP_START + SCORE_GAP_EXTENSION);
+constexpr int BONUS_FIRST_CHAR_MULTIPLIER = 2;
+constexpr int NO_MATCH = INT_MIN;  // scores can be negative once gap penalties exceed the bonuses
+
+enum Class { NON_WORD, LETTER, NUMBER };
+
+char fold(char c) { return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c; }
+
+Class charClass(char c) {
+  if ((c >= 'a' && c <= 'z') || (uint8_t)c >= 0x80) return LETTER;
+  if (c >= '0' && c <= '9') return NUMBER;
+  return NON_WORD;
+}
+
+int bonus(Class prev, Class cur) {
+  if (prev == NON_WORD && cur != NON_WORD) return BONUS_BOUNDARY;
+  if (prev != NUMBER && cur == NUMBER) return BONUS_NUMBER;
+  if (cur == NON_WORD) return BONUS_NON_WORD;
+  return 0;
+}
+
+// One bit per letter and digit, the other bytes share the remaining bits. A text can only match a query
+// whose mask is a subset of its own, which rules out most items with a couple of instructions each.
+uint64_t charBit(char c) {
+  if (c >= 'a' && c <= 'z') return 1ull << (c - 'a');
+  if (c >= '0' && c <= '9') return 1ull << (26 + c - '0');
+  return 1ull << (36 + (uint8_t)c % 28);
+}
+
+uint64_t charMask(std::string_view str) {
+  uint64_t mask = 0;
+  for (char c : str) mask |= charBit(c);
+  return mask;
+}
+
+// Score of term in text, or NO_MATCH. The term's characters are found in order with memchr, then the match is
+// shortened by scanning back from its end, and the window scored like fzf does.
+int scoreTerm(std::string_view text, std::string_view term) {
+  size_t end = 0;
+  for (char c : term) {
+    auto found = (const char *)std::memchr(text.data() + end, c, text.size() - end);
+    if (found == nullptr) return NO_MATCH;
+    end = found - text.data() + 1;
+  }
+  size_t start = end;
+  for (size_t i = term.size(); i > 0; start--)
+    if (text[start - 1] == term[i - 1]) i--;
+
+  int score = 0, firstBonus = 0, consecutive = 0;
+  bool inGap = false;
+  Class prev = start > 0 ? charClass(text[start - 1]) : NON_WORD;
+  for (size_t i = start, pos = 0; i < end; i++) {
+    Class cur = charClass(text[i]);
+    if (text[i] == term[pos]) {
+      int b = bonus(prev, cur);
+      if (consecutive == 0) {
+        firstBonus = b;
+      } else {
+        if (b >= BONUS_BOUNDARY && b > firstBonus) firstBonus = b;
+        b = std::max({b, firstBonus, BONUS_CONSECUTIVE});
+      }
+      score += SCORE_MATCH + (pos == 0 ? b * BONUS_FIRST_CHAR_MULTIPLIER : b);
+      inGap = false;
+      consecutive++;
+      pos++;
+    } else {
+      score += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+      inGap = true;
+      consecutive = 0;
+      firstBonus = 0;
+    }
+    prev = cur;
+  }
+  return score;
+}
+}  // namespace
+
+void FuzzyMatcher::clear() {
+  buffer.clear();
+  items.clear();
+  query.clear();
+  matched.clear();
+  scored.clear();
+  result.clear();
+  scanned = 0;
+}
+
+void FuzzyMatcher::reserve(size_t count) {
+  items.reserve(count);
+  buffer.reserve(count * 64);
+}
+
+FuzzyMatcher::Field FuzzyMatcher::store(std::string_view str) {
+  Field field{(uint32_t)buffer.size(), (uint32_t)str.size(), 0};
+  for (char c : str) buffer += fold(c);
+  field.mask = charMask({buffer.data() + field.offset, field.size});
+  return field;
+}
+
+void FuzzyMatcher::add(std::string_view text, std::string_view detail) {
+  items.push_back({store(text), store(detail)});
+}
+
+int FuzzyMatcher::score(const Field &field, const std::vector<std::string_view> &terms) const {
+  std::string_view text(buffer.data() + field.offset, field.size);
+  int total = 0;
+  for (auto &term : terms) {
+    int termScore = scoreTerm(text, term);
+    if (termScore == NO_MATCH) return NO_MATCH;
+    total += termScore;
+  }
+  return total;
+}
+
+const std::vector<uint32_t> &FuzzyMatcher::match(std::string_view input) {
+  std::string folded;
+  for (char c : input) folded += fold(c);
+  std::vector<std::string_view> terms;
+  for (size_t start = 0, end; start < folded.size(); start = end + 1) {
+    end = std::min(folded.find(' ', start), folded.size());
+    if (end > start) terms.push_back(std::string_view(folded).substr(start, end - start));
+  }
+
+  // With the same query only the items added since are scored and merged into the previous matches,
+  // otherwise the previous matches, or all items, are scored again.
+  size_t from = 0;
+  if (folded == query) {
+    from = matched.size();
+  } else if (!folded.starts_with(query)) {
+    matched.resize(scanned);
+    std::iota(matched.begin(), matched.end(), 0);
+  }
+  for (size_t i = scanned; i < items.size(); i++) matched.push_back((uint32_t)i);
+  query = folded;
+  scanned = items.size();
+
+  result.clear();
+  if (terms.empty()) {
+    scored.clear();
+    result = matched;
+    return result;
+  }
+  if (from == 0) scored.clear();
+
+  uint64_t mask = 0;
+  for (auto &term : terms) mask |= charMask(term);
+  size_t kept = from, sorted = scored.size();
+  for (size_t i = from; i < matched.size(); i++) {
+    uint32_t index = matched[i];
+    auto &item = items[index];
+    bool text = (item.text.mask & mask) == mask, detail = (item.detail.mask & mask) == mask;
+    if (!text && !detail) continue;
+    int tier = 0, score = text ? this->score(item.text, terms) : NO_MATCH;
+    if (score == NO_MATCH) tier = 1, score = detail ? this->score(item.detail, terms) : NO_MATCH;
+    if (score == NO_MATCH) continue;
+    matched[kept++] = index;
+
+    // Sorts by tier, then by descending score, then by length of the matched field, then by index. The score
+    // is offset so negative ones still rank among themselves.
+    uint32_t size = tier == 0 ? item.text.size : item.detail.size;
+    uint64_t key = (uint64_t)tier << 63 | (uint64_t)(0x7fff - std::clamp(score + 0x4000, 0, 0x7fff)) << 48 |
+                   (uint64_t)std::min(size, 0xffffu) << 32 | index;
+    scored.push_back(key);
+  }
+  matched.resize(kept);
+
+  std::sort(scored.begin() + sorted, scored.end());
+  std::inplace_merge(scored.begin(), scored.begin() + sorted, scored.end());
+  result.reserve(scored.size());
+  for (auto key : scored) result.push_back((uint32_t)key);
+  return result;
+}
+}  // namespace ImPlay
@@ -18,6 +18,13 @@ bool ImGui::IsAnyKeyPressed() {
   return false;
 }
 
+// whether drawList is the only one in drawData with anything to draw
+bool ImGui::IsDrawListOnly(ImDrawData* drawData, ImDrawList* drawList) {
+  for (auto list : drawData->CmdLists)
+    if (list != drawList && list->VtxBuffer.Size > 0) return false;
+  return true;
+}
+
 void ImGui::HalignCenter(const char* text) {
   ImGui::SetCursorPosX((ImGui::GetWindowWidth() - ImGui::CalcTextSize(text).x) * 0.5f);
 }
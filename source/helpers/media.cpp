@@ -0,0 +1,110 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <cstring>
+#include <fstream>
+#include "helpers/media.h"
+
+namespace ImPlay::Media {
+namespace {
+constexpr size_t SNIFF_SIZE = 4096;
+
+bool match(const uint8_t *data, size_t size, size_t offset, std::string_view magic) {
+  return size >= offset + magic.size() && std::memcmp(data + offset, magic.data(), magic.size()) == 0;
+}
+
+bool contains(const uint8_t *data, size_t size, std::string_view needle) {
+  std::string_view haystack((const char *)data, size);
+  return haystack.find(needle) != std::string_view::npos;
+}
+
+// MPEG transport streams: a sync byte every 188 bytes, 192 for Blu-ray streams with a 4 byte timecode
+bool isTransportStream(const uint8_t *data, size_t size) {
+  for (size_t packet : {188, 192}) {
+    size_t start = packet - 188;
+    if (size < start + 2 * packet + 1) continue;
+    if (data[start] == 0x47 && data[start + packet] == 0x47 && data[start + 2 * packet] == 0x47) return true;
+  }
+  return false;
+}
+
+// SubRip: a cue number on the first line and a timing line with --> right after it
+bool isSubRip(const uint8_t *data, size_t size) {
+  size_t i = 0;
+  while (i < size && (data[i] == '\r' || data[i] == '\n')) i++;
+  size_t digits = i;
+  while (i < size && data[i] >= '0' && data[i] <= '9') i++;
+  if (i == digits || i >= size || (data[i] != '\r' && data[i] != '\n')) return false;
+  std::string_view rest((const char *)data + i, std::min<size_t>(size - i, 64));
+  return rest.find("-->") != std::string_view::npos;
+}
+}  // namespace
+
+Type sniff(const uint8_t *data, size_t size) {
+  if (match(data, size, 0, "\x1a\x45\xdf\xa3")) return Type::Video;  // Matroska, WebM
+  if (match(data, size, 4, "ftyp")) return match(data, size, 8, "M4A ") ? Type::Audio : Type::Video;
+  if (match(data, size, 0, "RIFF")) {
+    if (match(data, size, 8, "AVI ")) return Type::Video;
+    if (match(data, size, 8, "WAVE")) return Type::Audio;
+    if (match(data, size, 8, "WEBP")) return Type::Image;
+  }
+  if (match(data, size, 0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11")) return Type::Video;  // ASF, WMV, WMA
+  if (match(data, size, 0, "FLV\x01") || match(data, size, 0, ".RMF")) return Type::Video;
+  if (match(data, size, 0, std::string_view("\x00\x00\x01\xba", 4)) ||
+      match(data, size, 0, std::string_view("\x00\x00\x01\xb3", 4)))
+    return Type::Video;  // MPEG program and elementary streams
+  if (isTransportStream(data, size)) return Type::Video;
+  if (match(data, size, 0, "OggS")) return contains(data, size, "theora") ? Type::Video : Type::Audio;
+
+  if (match(data, size, 0, "fLaC") || match(data, size, 0, "ID3")) return Type::Audio;
+  if (match(data, size, 0, "FORM") && (match(data, size, 8, "AIFF") || match(data, size, 8, "AIFC")))
+    return Type::Audio;
+  if (match(data, size, 0, "MAC ") || match(data, size, 0, "wvpk") || match(data, size, 0, "caff"))
+    return Type::Audio;
+  if (match(data, size, 0, "\x0b\x77") || match(data, size, 0, "\x7f\xfe\x80\x01")) return Type::Audio;  // AC3, DTS
+  if (size >= 2 && data[0] == 0xff && (data[1] & 0xe0) == 0xe0) return Type::Audio;  // MPEG audio, ADTS
+
+  if (match(data, size, 0, "\x89PNG") || match(data, size, 0, "\xff\xd8\xff")) return Type::Image;
+  if (match(data, size, 0, "GIF8") || match(data, size, 0, "BM")) return Type::Image;
+
+  if (match(data, size, 0, "\xef\xbb\xbf")) data += 3, size -= 3;
+  if (match(data, size, 0, "WEBVTT") || match(data, size, 0, "[Script Info]")) return Type::Subtitle;
+  if (isSubRip(data, size)) return Type::Subtitle;
+  return Type::None;
+}
+
+Type sniff(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return Type::None;
+  uint8_t data[SNIFF_SIZE];
+  file.read((char *)data, sizeof(data));
+  return sniff(data, (size_t)file.gcount());
+}
+
+Type classify(const std::filesystem::path &path, bool sniff) {
+  using View = std::basic_string_view<std::filesystem::path::value_type>;
+  View name(path.native());
+  for (size_t i = name.size(); i > 0; i--) {
+    auto c = name[i - 1];
+    if (c == '/' || c == std::filesystem::path::preferred_separator) {
+      name.remove_prefix(i);
+      break;
+    }
+  }
+  auto dot = name.rfind('.');
+
+  Type type = dot == View::npos || dot == 0 ? Type::None : fromExtension(name.substr(dot + 1));
+  if (type == Type::None && sniff) type = Media::sniff(path);
+  return type;
+}
+
+std::string extensions(Type type, const char *separator) {
+  std::string result;
+  for (auto &ext : detail::extensions) {
+    if (ext.type != type) continue;
+    if (!result.empty()) result += separator;
+    result += ext.name;
+  }
+  return result;
+}
+}  // namespace ImPlay::Media
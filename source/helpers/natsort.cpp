@@ -0,0 +1,119 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include "helpers/natsort.h"
+
+namespace ImPlay {
+void NaturalSort::reserve(size_t count) {
+  keys.reserve(count);
+  buffer.reserve(count * 32);
+}
+
+// Spaces are dropped and letters upper-cased like strnatcasecmp does. A run of digits becomes a '0'
+// marker, which orders it against other characters like any digit, followed by its length without
+// leading zeros and the digits themselves, so longer numbers sort after shorter ones.
+void NaturalSort::add(std::string_view str) {
+  size_t offset = buffer.size();
+  for (size_t i = 0; i < str.size();) {
+    uint8_t c = str[i];
+    if (c == ' ' || (c >= '\t' && c <= '\r')) {
+      i++;
+    } else if (c >= '0' && c <= '9') {
+      while (i < str.size() && str[i] == '0') i++;
+      size_t start = i;
+      while (i < str.size() && str[i] >= '0' && str[i] <= '9') i++;
+      buffer += '0';
+      buffer += (char)std::min<size_t>(i - start, 255);
+      buffer.append(str, start, i - start);
+    } else {
+      buffer += (char)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+      i++;
+    }
+  }
+  keys.push_back({(uint32_t)offset, (uint32_t)(buffer.size() - offset)});
+}
+
+bool NaturalSort::less(uint32_t a, uint32_t b) const {
+  auto &ka = keys[a], &kb = keys[b];
+  int result = std::memcmp(buffer.data() + ka.offset, buffer.data() + kb.offset, std::min(ka.size, kb.size));
+  if (result != 0) return result < 0;
+  if (ka.size != kb.size) return ka.size < kb.size;
+  return a < b;
+}
+
+// Large lists are split into one chunk per thread, then the sorted chunks are merged pairwise.
+std::vector<uint32_t> NaturalSort::sort(bool reverse, bool parallel) const {
+  std::vector<uint32_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  auto less = [this](uint32_t a, uint32_t b) { return this->less(a, b); };
+
+  size_t chunks = 1;
+  if (parallel && order.size() >= PARALLEL_THRESHOLD)
+    while (chunks * 2 <= std::min(std::thread::hardware_concurrency(), 8u)) chunks *= 2;
+
+  if (chunks == 1) {
+    std::sort(order.begin(), order.end(), less);
+  } else {
+    auto bound = [&](size_t chunk) { return order.begin() + order.size() * chunk / chunks; };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < chunks; i++)
+      threads.emplace_back([&, i]() { std::sort(bound(i), bound(i + 1), less); });
+    for (auto &thread : threads) thread.join();
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+      threads.clear();
+      for (size_t i = 0; i + width < chunks; i += 2 * width)
+        threads.emplace_back([&, i, width]() {
+          std::inplace_merge(bound(i), bound(i + width), bound(std::min(i + 2 * width, chunks)), less);
+        });
+      for (auto &thread : threads) thread.join();
+    }
+  }
+
+  if (reverse) std::reverse(order.begin(), order.end());
+  return order;
+}
+
+// The entries on a longest increasing subsequence of order stay, every other entry is moved right behind
+// the one that precedes it in order, in order. mpv's playlist-move puts the entry in front of the one at
+// the target index, which may be the count of entries to move it to the end.
+std::optional<std::vector<std::pair<size_t, size_t>>> NaturalSort::moves(const std::vector<uint32_t> &order,
+                                                                          size_t limit) {
+  size_t n = order.size();
+  std::vector<size_t> tails, prev(n);  // tails[k]: position in order of the smallest tail of a run of k + 1
+  for (size_t i = 0; i < n; i++) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), order[i],
+                               [&](size_t pos, uint32_t value) { return order[pos] < value; });
+    prev[i] = it == tails.begin() ? SIZE_MAX : *(it - 1);
+    if (it == tails.end())
+      tails.push_back(i);
+    else
+      *it = i;
+  }
+  if (n - tails.size() > limit) return std::nullopt;
+
+  std::vector<bool> stays(n);
+  for (size_t i = tails.empty() ? SIZE_MAX : tails.back(); i != SIZE_MAX; i = prev[i]) stays[order[i]] = true;
+
+  std::vector<std::pair<size_t, size_t>> result;
+  std::vector<uint32_t> current(n);
+  std::iota(current.begin(), current.end(), 0);
+  auto indexOf = [&](uint32_t value) {
+    return (size_t)(std::find(current.begin(), current.end(), value) - current.begin());
+  };
+  for (size_t i = 0; i < n; i++) {
+    if (stays[order[i]]) continue;
+    size_t from = indexOf(order[i]);
+    size_t to = i == 0 ? 0 : indexOf(order[i - 1]) + 1;
+    if (to == from || to == from + 1) continue;
+    result.push_back({from, to});
+    current.erase(current.begin() + from);
+    current.insert(current.begin() + (to > from ? to - 1 : to), order[i]);
+  }
+  return result;
+}
+}  // namespace ImPlay
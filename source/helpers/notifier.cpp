@@ -0,0 +1,90 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "helpers/notifier.h"
+
+namespace ImPlay {
+void Notifier::notify() {
+  if (state.exchange(NOTIFIED) == SLEEPING) wake();
+}
+
+void Notifier::wait() {
+  while (true) {
+    uint32_t s = state.load();
+    if (s == NOTIFIED && state.compare_exchange_weak(s, IDLE)) return;
+    if (s == IDLE && !state.compare_exchange_weak(s, SLEEPING)) continue;
+    if (s != NOTIFIED) sleep(nullptr);
+  }
+}
+
+bool Notifier::wait_until(Clock::time_point deadline) {
+  while (true) {
+    uint32_t s = state.load();
+    if (s == NOTIFIED && state.compare_exchange_weak(s, IDLE)) return true;
+    if (s == IDLE && !state.compare_exchange_weak(s, SLEEPING)) continue;
+    if (s == NOTIFIED) continue;
+    if (!sleep(&deadline)) {
+      uint32_t expected = SLEEPING;
+      if (state.compare_exchange_strong(expected, IDLE)) return false;
+    }
+  }
+}
+
+#ifdef __linux__
+// FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, the same clock as steady_clock
+bool Notifier::sleep(const Clock::time_point *deadline) {
+  timespec ts, *timeout = nullptr;
+  if (deadline != nullptr) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline->time_since_epoch()).count();
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    timeout = &ts;
+  }
+  long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                     SLEEPING, timeout, nullptr, FUTEX_BITSET_MATCH_ANY);
+  return ret == 0 || errno != ETIMEDOUT;
+}
+
+void Notifier::wake() {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, nullptr, nullptr, 0);
+}
+#elif defined(_WIN32)
+bool Notifier::sleep(const Clock::time_point *deadline) {
+  DWORD ms = INFINITE;
+  if (deadline != nullptr) {
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now()).count();
+    ms = left > 0 ? static_cast<DWORD>(left) : 0;
+  }
+  uint32_t sleeping = SLEEPING;
+  if (WaitOnAddress(&state, &sleeping, sizeof(sleeping), ms)) return true;
+  return GetLastError() != ERROR_TIMEOUT;
+}
+
+void Notifier::wake() { WakeByAddressSingle(&state); }
+#else
+bool Notifier::sleep(const Clock::time_point *deadline) {
+  std::unique_lock<std::mutex> l(lock);
+  auto woken = [this] { return state.load() != SLEEPING; };
+  if (deadline == nullptr) {
+    cond.wait(l, woken);
+    return true;
+  }
+  return cond.wait_until(l, *deadline, woken);
+}
+
+// only taken when the waiter sleeps, so the wakeup can't slip in between its check and wait
+void Notifier::wake() {
+  { std::lock_guard<std::mutex> l(lock); }
+  cond.notify_one();
+}
+#endif
+}  // namespace ImPlay
@@ -0,0 +1,60 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <vector>
+#include "metrics.h"
+
+namespace ImPlay {
+void Metrics::Histogram::add(int64_t us) {
+  uint32_t n = count.fetch_add(1, std::memory_order_relaxed);
+  samples[n % SIZE].store(static_cast<uint32_t>(std::clamp<int64_t>(us, 0, UINT32_MAX)), std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Summary Metrics::Histogram::summary() const {
+  Summary s;
+  s.count = std::min<uint32_t>(count.load(std::memory_order_relaxed), SIZE);
+  if (s.count == 0) return s;
+
+  std::vector<uint32_t> values(s.count);
+  for (int i = 0; i < s.count; i++) values[i] = samples[i].load(std::memory_order_relaxed);
+  std::sort(values.begin(), values.end());
+
+  auto at = [&](double p) { return static_cast<int64_t>(values[static_cast<int>(p * (s.count - 1))]); };
+  s.p50 = at(0.50);
+  s.p95 = at(0.95);
+  s.p99 = at(0.99);
+  s.max = values.back();
+  return s;
+}
+
+Metrics::Probe::~Probe() {
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  histogram.add(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+const char *Metrics::phaseName(Phase phase) {
+  switch (phase) {
+    case PHASE_EVENTS:
+      return "GLFW Events";
+    case PHASE_MPV_EVENTS:
+      return "mpv Events";
+    case PHASE_NEW_FRAME:
+      return "NewFrame + draw";
+    case PHASE_RENDER:
+      return "ImGui::Render";
+    case PHASE_COMPOSITE:
+      return "Composite";
+    case PHASE_SWAP:
+      return "SwapBuffers";
+    case PHASE_FRAME:
+      return "UI Frame";
+    case PHASE_VIDEO:
+      return "Video Render";
+    case PHASE_SYNC:
+      return "glFinish Sync";
+    default:
+      return "";
+  }
+}
+}  // namespace ImPlay
@@ -1,15 +1,108 @@
 // Copyright (c) 2022-2025 tsl0922. All rights reserved.
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <thread>
 #include <cstdarg>
+#include <cstdlib>
 #include <cstring>
+#include <sstream>
 #include <nlohmann/json.hpp>
 #include "mpv.h"
 
 namespace ImPlay {
+static void freeNode(mpv_node &node) {
+  switch (node.format) {
+    case MPV_FORMAT_STRING:
+      std::free(node.u.string);
+      break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP:
+      for (int i = 0; i < node.u.list->num; i++) {
+        freeNode(node.u.list->values[i]);
+        if (node.u.list->keys) std::free(node.u.list->keys[i]);
+      }
+      delete[] node.u.list->values;
+      delete[] node.u.list->keys;
+      delete node.u.list;
+      break;
+    default:
+      break;
+  }
+  node = mpv_node{};
+}
+
+static void copyNode(mpv_node &dst, const mpv_node &src) {
+  dst.format = src.format;
+  switch (src.format) {
+    case MPV_FORMAT_STRING:
+      dst.u.string = strdup(src.u.string);
+      break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+      auto *list = new mpv_node_list{src.u.list->num, new mpv_node[src.u.list->num]{}, nullptr};
+      if (src.u.list->keys) list->keys = new char *[list->num];
+      for (int i = 0; i < list->num; i++) {
+        copyNode(list->values[i], src.u.list->values[i]);
+        if (src.u.list->keys) list->keys[i] = strdup(src.u.list->keys[i]);
+      }
+      dst.u.list = list;
+    } break;
+    default:
+      dst.u = src.u;
+      break;
+  }
+}
+
+// stores a property value in a node we own, the event data is only valid until the next mpv_wait_event
+static void storeProperty(mpv_node &dst, mpv_format format, void *data) {
+  freeNode(dst);
+  switch (format) {
+    case MPV_FORMAT_NODE:
+      copyNode(dst, *(mpv_node *)data);
+      break;
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+      dst.format = MPV_FORMAT_STRING;
+      dst.u.string = strdup(*(char **)data);
+      break;
+    case MPV_FORMAT_FLAG:
+      dst.format = format;
+      dst.u.flag = *(int *)data;
+      break;
+    case MPV_FORMAT_INT64:
+      dst.format = format;
+      dst.u.int64 = *(int64_t *)data;
+      break;
+    case MPV_FORMAT_DOUBLE:
+      dst.format = format;
+      dst.u.double_ = *(double *)data;
+      break;
+    default:
+      break;
+  }
+}
+
+static void *propertyData(mpv_node &node, mpv_format format) {
+  switch (format) {
+    case MPV_FORMAT_NODE:
+      return &node;
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+      return &node.u.string;
+    case MPV_FORMAT_FLAG:
+      return &node.u.flag;
+    case MPV_FORMAT_INT64:
+      return &node.u.int64;
+    case MPV_FORMAT_DOUBLE:
+      return &node.u.double_;
+    default:
+      return nullptr;
+  }
+}
+
 Mpv::Mpv() {
   main = mpv_create();
   if (!main) throw std::runtime_error("could not create mpv handle");
@@ -18,42 +111,477 @@ Mpv::Mpv() {
 }
 
 Mpv::~Mpv() {
+  stateShutdown = true;
+  mpv_wakeup(mpv);
+  if (stateThread.joinable()) stateThread.join();
   if (renderCtx != nullptr) mpv_render_context_free(renderCtx);
-  mpv_unobserve_property(mpv, 0);
+  for (size_t i = 0; i < propertyEvents.size(); i++) mpv_unobserve_property(mpv, i + 1);
   mpv_destroy(main);
   mpv_destroy(mpv);
+  for (auto &item : pending) freeNode(item.value);
+}
+
+// Appends the escape sequence at the start of str (after the backslash) to out, like mpv does in double
+// quoted strings. Returns the length of the sequence, 0 if it is invalid.
+static size_t parseEscape(std::string_view str, std::string &out) {
+  auto hex = [&](size_t pos, size_t len, uint32_t &value) {
+    if (str.size() < pos + len) return false;
+    value = 0;
+    for (size_t i = pos; i < pos + len; i++) {
+      char c = str[i] | 0x20;
+      int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+      if (digit < 0) return false;
+      value = value * 16 + digit;
+    }
+    return true;
+  };
+  if (str.empty()) return 0;
+  switch (str[0]) {
+    case '"':
+    case '\\':
+    case '\'':
+      out += str[0];
+      return 1;
+    case 'b':
+      out += '\b';
+      return 1;
+    case 'f':
+      out += '\f';
+      return 1;
+    case 'n':
+      out += '\n';
+      return 1;
+    case 'r':
+      out += '\r';
+      return 1;
+    case 't':
+      out += '\t';
+      return 1;
+    case 'e':
+      out += '\x1b';
+      return 1;
+    default:
+      break;
+  }
+  uint32_t c;
+  if (str[0] == 'x') {
+    if (!hex(1, 2, c)) return 0;
+    out += (char)c;
+    return 3;
+  }
+  if (str[0] != 'u' || !hex(1, 4, c)) return 0;
+  size_t len = 5;
+  if (uint32_t low; c >= 0xd800 && c < 0xdc00 && str.substr(5, 2) == "\\u" && hex(7, 4, low) && low >= 0xdc00 &&
+                    low < 0xe000) {
+    c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+    len = 11;
+  }
+  if (c < 0x80) {
+    out += (char)c;
+  } else if (c < 0x800) {
+    out += (char)(0xc0 | c >> 6);
+    out += (char)(0x80 | (c & 0x3f));
+  } else if (c < 0x10000) {
+    out += (char)(0xe0 | c >> 12);
+    out += (char)(0x80 | (c >> 6 & 0x3f));
+    out += (char)(0x80 | (c & 0x3f));
+  } else {
+    out += (char)(0xf0 | c >> 18);
+    out += (char)(0x80 | (c >> 12 & 0x3f));
+    out += (char)(0x80 | (c >> 6 & 0x3f));
+    out += (char)(0x80 | (c & 0x3f));
+  }
+  return len;
+}
+
+// Splits a command string into the arguments of its commands the way mpv_command_string does: commands are
+// separated by ';', '#' starts a comment, and arguments may be quoted with "...", '...' or `X...X`.
+// Prefixes like no-osd stay in front of the arguments, mpv applies them to array commands too. String
+// commands expand properties and use the default OSD behavior, so both are prepended.
+static bool parseCommands(std::string_view str, std::vector<std::vector<std::string>> &commands) {
+  constexpr std::string_view space = " \f\n\r\t\v";
+  size_t pos = 0;
+  for (;;) {
+    std::vector<std::string> args{"osd-auto", "expand-properties"};
+    for (;;) {
+      pos = std::min(str.find_first_not_of(space, pos), str.size());
+      if (pos == str.size()) break;
+      std::string arg;
+      if (str[pos] == '"') {
+        for (pos++; pos < str.size() && str[pos] != '"';) {
+          if (str[pos] != '\\') {
+            arg += str[pos++];
+          } else if (size_t len = parseEscape(str.substr(pos + 1), arg); len > 0) {
+            pos += len + 1;
+          } else {
+            return false;
+          }
+        }
+        if (pos++ == str.size()) return false;
+      } else if (str[pos] == '\'') {
+        size_t end = str.find('\'', pos + 1);
+        if (end == std::string_view::npos) return false;
+        arg = str.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+      } else if (str[pos] == '`' && pos + 1 < str.size()) {
+        char quote[] = {str[pos + 1], '`'};
+        size_t end = str.find(std::string_view(quote, 2), pos + 2);
+        if (end == std::string_view::npos) return false;
+        arg = str.substr(pos + 2, end - pos - 2);
+        pos = end + 2;
+      } else {
+        size_t end = std::min(str.find_first_of(" \f\n\r\t\v#;", pos), str.size());
+        if (end == pos) break;
+        arg = str.substr(pos, end - pos);
+        pos = end;
+      }
+      args.push_back(std::move(arg));
+    }
+    if (args.size() == 2) return false;
+    commands.push_back(std::move(args));
+
+    if (pos == str.size() || str[pos] != ';') break;
+    pos = std::min(str.find_first_not_of(space, pos + 1), str.size());
+    if (pos == str.size() || str[pos] == '#' || str[pos] == ';') break;
+  }
+  return !commands.empty();
 }
 
-int Mpv::commandv(const char *arg, ...) {
-  std::vector<const char *> args;
+// latency of command strings is tracked by their command name, skipping prefixes like no-osd
+static std::string commandName(const std::vector<std::string> &args) {
+  static const char *prefixes[] = {"no-osd", "osd-auto", "osd-bar", "osd-msg", "osd-msg-bar", "raw",
+                                   "expand-properties", "repeatable", "nonrepeatable", "async", "sync"};
+  for (auto &arg : args) {
+    if (std::find(std::begin(prefixes), std::end(prefixes), arg) == std::end(prefixes)) return arg;
+  }
+  return "";
+}
+
+void Mpv::command(std::string args, const Reply &reply) {
+  std::vector<std::vector<std::string>> commands;
+  if (parseCommands(args, commands)) {
+    submit(commandName(commands[0]), commands, reply);
+    return;
+  }
+  requestCount++;
+  uint64_t id = addRequest("invalid command", MPV_FORMAT_NODE, reply);
+  {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    completeRequest(id, MPV_ERROR_INVALID_PARAMETER, MPV_FORMAT_NONE, nullptr);
+  }
+  if (reply && wakeupCb_) wakeupCb_(this);
+}
+
+void Mpv::command(const char *args[], const Reply &reply) {
+  std::vector<std::string> list;
+  for (int i = 0; args[i] != nullptr; i++) list.emplace_back(args[i]);
+  std::string name = list.empty() ? "" : list[0];
+  submit(std::move(name), {std::move(list)}, reply);
+}
+
+void Mpv::commandv(const char *arg, ...) {
+  std::vector<std::string> args;
   va_list ap;
   va_start(ap, arg);
-  for (const char *s = arg; s != nullptr; s = va_arg(ap, const char *)) args.push_back(s);
+  for (const char *s = arg; s != nullptr; s = va_arg(ap, const char *)) args.emplace_back(s);
   va_end(ap);
-  args.push_back(nullptr);
-  return mpv_command_async(mpv, 0, args.data());
+  std::string name = args.empty() ? "" : args[0];
+  submit(std::move(name), {std::move(args)}, nullptr);
+}
+
+void Mpv::setProperty(const char *name, mpv_format format, void *data) {
+  requestCount++;
+  uint64_t id = addRequest(std::string("set ") + name, MPV_FORMAT_NONE, nullptr);
+  if (int err = mpv_set_property_async(mpv, id, name, format, data); err < 0) {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    completeRequest(id, err, MPV_FORMAT_NONE, nullptr);
+  }
+}
+
+void Mpv::propertyDeferred(const char *name, std::string value) {
+  auto it = deferred.find(name);
+  if (it == deferred.end()) it = deferred.try_emplace(name).first;
+  auto &item = it->second;
+  item.value = std::move(value);
+  item.dirty = item.value != item.sent;
+}
+
+void Mpv::flushDeferred(const char *name) {
+  auto it = deferred.find(name);
+  if (it == deferred.end()) return;
+  if (it->second.dirty) property(name, it->second.value.c_str());
+  deferred.erase(it);  // the next drag starts fresh, the property may have changed in between
+}
+
+void Mpv::flushDeferred() {
+  for (auto &[name, item] : deferred) {
+    if (!item.dirty) continue;
+    property(name.c_str(), item.value.c_str());
+    item.sent = item.value;
+    item.dirty = false;
+  }
+}
+
+uint64_t Mpv::addRequest(std::string name, mpv_format format, const Reply &reply, int parts) {
+  std::lock_guard<std::mutex> guard(pendingLock);
+  uint64_t id = nextRequestId++;
+  pendingRequests[id] = {std::move(name), format, reply, time(), parts};
+  return id;
+}
+
+// Called with pendingLock held, once for each reply to request id. The reply is queued with the result of
+// the last one and the first error, once all parts replied.
+void Mpv::completeRequest(uint64_t id, int error, mpv_format format, void *data) {
+  auto it = pendingRequests.find(id);
+  if (it == pendingRequests.end()) return;
+  auto &request = it->second;
+  if (request.error >= 0 && error < 0) request.error = error;
+  if (--request.parts > 0) return;
+
+  record(request.name, request.submitted);
+  if (request.reply) {
+    error = request.error;
+    mpv_node value{};
+    if (error >= 0 && data != nullptr && format != request.format) error = MPV_ERROR_PROPERTY_UNAVAILABLE;
+    if (error >= 0 && data != nullptr) storeProperty(value, format, data);
+    queueReply(request.reply, error, value, request.format);
+  }
+  pendingRequests.erase(it);
+}
+
+// Each command of a command string is sent on its own, sharing the reply id, in order.
+void Mpv::submit(std::string name, const std::vector<std::vector<std::string>> &commands, const Reply &reply) {
+  requestCount++;
+  uint64_t id = addRequest(std::move(name), MPV_FORMAT_NODE, reply, (int)commands.size());
+  bool failed = false;
+  for (auto &command : commands) {
+    std::vector<const char *> args;
+    for (auto &arg : command) args.push_back(arg.c_str());
+    args.push_back(nullptr);
+    if (int err = mpv_command_async(mpv, id, args.data()); err < 0) {
+      std::lock_guard<std::mutex> guard(pendingLock);
+      completeRequest(id, err, MPV_FORMAT_NONE, nullptr);
+      failed = true;
+    }
+  }
+  if (failed && reply && wakeupCb_) wakeupCb_(this);
+}
+
+void Mpv::propertyAsync(const char *name, mpv_format format, const Reply &reply) {
+  uint64_t id = addRequest(std::string("get ") + name, format, reply);
+  if (int err = mpv_get_property_async(mpv, id, name, format); err < 0) {
+    {
+      std::lock_guard<std::mutex> guard(pendingLock);
+      completeRequest(id, err, format, nullptr);
+    }
+    if (wakeupCb_) wakeupCb_(this);
+  }
+}
+
+void Mpv::record(std::string_view name, int64_t submitted) {
+  std::lock_guard<std::mutex> guard(latencyLock);
+  auto it = latencies.find(name);
+  if (it == latencies.end()) it = latencies.try_emplace(std::string(name)).first;
+  it->second.add(time() - submitted);
 }
 
-void Mpv::waitEvent(double timeout) {
-  while (mpv) {
-    mpv_event *event = mpv_wait_event(mpv, timeout);
-    if (event->event_id == MPV_EVENT_NONE) break;
-    switch (event->event_id) {
+std::vector<std::pair<std::string, Metrics::Histogram::Summary>> Mpv::latency() {
+  std::vector<std::pair<std::string, Metrics::Histogram::Summary>> result;
+  std::lock_guard<std::mutex> guard(latencyLock);
+  for (auto &[name, histogram] : latencies) result.emplace_back(name, histogram.summary());
+  return result;
+}
+
+void Mpv::resetLatency() {
+  std::lock_guard<std::mutex> guard(latencyLock);
+  latencies.clear();
+}
+
+// Runs the handlers queued by the event thread, on the calling (UI) thread.
+// Returns whether any handler was called or a new state was published since the last call.
+bool Mpv::processEvents() {
+  std::vector<Pending> queue;
+  {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    for (auto i : openProperties) propertyEvents[i].queued = -1;
+    openProperties.clear();
+    queue.swap(pending);
+  }
+
+  if (!deferred.empty() && time() - deferFlushed >= deferInterval) {
+    flushDeferred();
+    deferFlushed = time();
+  }
+
+  for (auto &item : queue) {
+    switch (item.event) {
       case MPV_EVENT_PROPERTY_CHANGE: {
-        auto *prop = (mpv_event_property *)event->data;
-        for (const auto &[name, format, handler] : propertyEvents)
-          if (name == prop->name && format == prop->format) handler(prop->data);
-        break;
-      }
+        auto &entry = propertyEvents[item.property];
+        entry.handler(propertyData(item.value, entry.format));
+      } break;
       case MPV_EVENT_LOG_MESSAGE: {
-        mpv_event_log_message *msg = (mpv_event_log_message *)event->data;
-        if (logHandler) logHandler(msg->prefix, msg->level, msg->text);
+        auto *args = item.value.u.list->values;
+        if (logHandler) logHandler(args[0].u.string, args[1].u.string, args[2].u.string);
+      } break;
+      case MPV_EVENT_COMMAND_REPLY:
+        item.reply(item.error, item.error >= 0 ? propertyData(item.value, item.format) : nullptr);
+        break;
+      case MPV_EVENT_CLIENT_MESSAGE: {
+        std::vector<const char *> args;
+        for (int i = 0; i < item.value.u.list->num; i++) args.push_back(item.value.u.list->values[i].u.string);
+        mpv_event_client_message msg{(int)args.size(), args.data()};
+        for (const auto &handler : events.at(item.event)) handler(&msg);
       } break;
       default:
-        for (const auto &[event_id, handler] : events)
-          if (event_id == event->event_id) handler(event->data);
+        for (const auto &handler : events.at(item.event)) handler(nullptr);
         break;
     }
+    freeNode(item.value);
+  }
+
+  uint64_t version = state()->version;
+  bool changed = version != stateVersion;
+  stateVersion = version;
+  return changed || !queue.empty();
+}
+
+void Mpv::observeProperty(const std::string &name, mpv_format format, const EventHandler &handler,
+                          const StateUpdater &update) {
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> guard(pendingLock);
+    propertyEvents.push_back({name, format, handler, update});
+    id = propertyEvents.size();
+  }
+  mpv_observe_property(mpv, id, name.c_str(), format);
+}
+
+// called on the event thread with pendingLock held
+void Mpv::queueProperty(size_t index, mpv_format format, void *data) {
+  auto &entry = propertyEvents[index];
+  if (entry.queued < 0) {
+    entry.queued = (int)pending.size();
+    pending.push_back({MPV_EVENT_PROPERTY_CHANGE, index});
+    openProperties.push_back(index);
+  }
+  storeProperty(pending[entry.queued].value, format, data);
+}
+
+// called on the event thread with pendingLock held
+void Mpv::queueEvent(mpv_event *event) {
+  for (auto i : openProperties) propertyEvents[i].queued = -1;
+  openProperties.clear();
+
+  Pending item{event->event_id};
+  auto strings = [&](int num, const char *const *values) {
+    auto *list = new mpv_node_list{num, new mpv_node[num]{}, nullptr};
+    for (int i = 0; i < num; i++) {
+      list->values[i].format = MPV_FORMAT_STRING;
+      list->values[i].u.string = strdup(values[i]);
+    }
+    item.value.format = MPV_FORMAT_NODE_ARRAY;
+    item.value.u.list = list;
+  };
+  if (event->event_id == MPV_EVENT_LOG_MESSAGE) {
+    auto *msg = (mpv_event_log_message *)event->data;
+    const char *values[] = {msg->prefix, msg->level, msg->text};
+    strings(3, values);
+  } else if (event->event_id == MPV_EVENT_CLIENT_MESSAGE) {
+    auto *msg = (mpv_event_client_message *)event->data;
+    strings(msg->num_args, msg->args);
+  }
+  pending.push_back(item);
+}
+
+// Called with pendingLock held, takes ownership of value. Replies to commands and property reads are
+// queued as MPV_EVENT_COMMAND_REPLY, value holds the result in the given format.
+void Mpv::queueReply(const Reply &reply, int error, mpv_node &value, mpv_format format) {
+  for (auto i : openProperties) propertyEvents[i].queued = -1;
+  openProperties.clear();
+
+  pending.push_back({MPV_EVENT_COMMAND_REPLY, 0, value, reply, format, error});
+  value = mpv_node{};
+}
+
+// Drains mpv's event queue on a dedicated thread: property changes are folded into the next state, which
+// is published at the end of the drain, and everything with a UI handler is queued for processEvents. A
+// handler must see the changes mpv sent before it, so pending changes are published before anything is
+// queued behind them.
+void Mpv::stateLoop() {
+  State next = *state();
+  bool shutdown = false;
+  while (!stateShutdown && !shutdown) {
+    bool changed = false, published = false, queued = false;
+    auto publish = [&]() {
+      if (!changed) return;
+      next.version++;
+      state_.store(std::make_shared<const State>(next));
+      changed = false;
+      published = true;
+    };
+    mpv_event *event = mpv_wait_event(mpv, -1);
+    for (; event->event_id != MPV_EVENT_NONE; event = mpv_wait_event(mpv, 0)) {
+      if (event->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+        auto *prop = (mpv_event_property *)event->data;
+        uint64_t id = event->reply_userdata;
+        PropertyEvent *entry = nullptr;
+        {
+          std::lock_guard<std::mutex> guard(pendingLock);
+          if (id > 0 && id <= propertyEvents.size()) entry = &propertyEvents[id - 1];
+        }
+        if (entry == nullptr || prop->format != entry->format) continue;
+        if (entry->update) {
+          entry->update(next, prop->data);  // outside the lock, building large lists must not block the UI
+          changed = true;
+        } else {
+          publish();
+          std::lock_guard<std::mutex> guard(pendingLock);
+          queueProperty(id - 1, prop->format, prop->data);
+          queued = true;
+        }
+        continue;
+      }
+
+      if (event->event_id == MPV_EVENT_GET_PROPERTY_REPLY) {
+        auto *prop = (mpv_event_property *)event->data;
+        publish();
+        std::lock_guard<std::mutex> guard(pendingLock);
+        completeRequest(event->reply_userdata, event->error, prop->format, prop->data);
+        queued = true;
+        continue;
+      }
+      if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
+        auto *cmd = (mpv_event_command *)event->data;
+        publish();
+        std::lock_guard<std::mutex> guard(pendingLock);
+        completeRequest(event->reply_userdata, event->error, MPV_FORMAT_NODE, &cmd->result);
+        queued = true;
+        continue;
+      }
+      if (event->event_id == MPV_EVENT_SET_PROPERTY_REPLY) {
+        publish();
+        std::lock_guard<std::mutex> guard(pendingLock);
+        completeRequest(event->reply_userdata, event->error, MPV_FORMAT_NONE, nullptr);
+        queued = true;
+        continue;
+      }
+
+      if (event->event_id == MPV_EVENT_SHUTDOWN) shutdown = true;
+      std::unique_lock<std::mutex> guard(pendingLock);
+      if (event->event_id == MPV_EVENT_LOG_MESSAGE || events.contains(event->event_id)) {
+        if (changed) {
+          guard.unlock();
+          publish();
+          guard.lock();
+        }
+        queueEvent(event);
+        queued = true;
+      }
+      if (shutdown) break;
+    }
+
+    publish();
+    if ((published || queued) && wakeupCb_) wakeupCb_(this);
   }
 }
 
@@ -75,19 +603,35 @@ void Mpv::render(int w, int h, int fbo, bool flip) {
   if (renderCtx == nullptr) return;
 
   int flip_y{flip ? 1 : 0};
+  int block{0};  // frames are held until their target time by the caller
   mpv_opengl_fbo mpfbo{fbo, w, h};
   mpv_render_param params[]{
       {MPV_RENDER_PARAM_OPENGL_FBO, &mpfbo},
       {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+      {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block},
       {MPV_RENDER_PARAM_INVALID, nullptr},
   };
   mpv_render_context_render(renderCtx, params);
 }
 
+void Mpv::freeRender() {
+  if (renderCtx != nullptr) mpv_render_context_free(renderCtx);
+  renderCtx = nullptr;
+}
+
 bool Mpv::wantRender() {
   return renderCtx != nullptr && (mpv_render_context_update(renderCtx) & MPV_RENDER_UPDATE_FRAME);
 }
 
+// target time of the frame that will be rendered next, 0 if it should be shown as soon as possible
+int64_t Mpv::nextFrameTime() {
+  if (renderCtx == nullptr) return 0;
+  mpv_render_frame_info info{};
+  if (mpv_render_context_get_info(renderCtx, {MPV_RENDER_PARAM_NEXT_FRAME_INFO, &info}) < 0) return 0;
+  if (!(info.flags & MPV_RENDER_FRAME_INFO_PRESENT) || (info.flags & MPV_RENDER_FRAME_INFO_REDRAW)) return 0;
+  return info.target_time;
+}
+
 void Mpv::reportSwap() {
   if (renderCtx != nullptr) mpv_render_context_report_swap(renderCtx);
 }
@@ -119,85 +663,93 @@ void Mpv::init(GLAddrLoadFunc load, int64_t wid) {
 
   mpv_request_log_messages(main, "no");
 
-  mpv_set_wakeup_callback(
-      mpv,
-      [](void *ctx) {
-        Mpv *mpv = static_cast<Mpv *>(ctx);
-        if (mpv->wakeupCb_) mpv->wakeupCb_(mpv);
-      },
-      this);
   std::thread(&Mpv::eventLoop, this).detach();
 
-  forceWindow = property<int, MPV_FORMAT_FLAG>("force-window");
+  auto initial = std::make_shared<State>();
+  initial->forceWindow = property<int, MPV_FORMAT_FLAG>("force-window");
+  state_.store(initial);
   observeProperties();
+  stateThread = std::thread(&Mpv::stateLoop, this);
 }
 
 void Mpv::observeProperties() {
-  observeProperty<mpv_node, MPV_FORMAT_NODE>("playlist", [this](mpv_node node) { initPlaylist(node); });
-  observeProperty<mpv_node, MPV_FORMAT_NODE>("chapter-list", [this](mpv_node node) { initChapters(node); });
-  observeProperty<mpv_node, MPV_FORMAT_NODE>("track-list", [this](mpv_node node) { initTracks(node); });
-  observeProperty<mpv_node, MPV_FORMAT_NODE>("audio-device-list", [this](mpv_node node) { initAudioDevices(node); });
-  observeProperty<mpv_node, MPV_FORMAT_NODE>("input-bindings", [this](mpv_node node) { initBindings(node); });
-  observeProperty<char *, MPV_FORMAT_STRING>("profile-list", [this](char *data) { initProfiles(data); });
-
-  observeProperty<char *, MPV_FORMAT_STRING>("aid", [this](char *data) { aid = data; });
-  observeProperty<char *, MPV_FORMAT_STRING>("vid", [this](char *data) { vid = data; });
-  observeProperty<char *, MPV_FORMAT_STRING>("sid", [this](char *data) { sid = data; });
-  observeProperty<char *, MPV_FORMAT_STRING>("secondary-sid", [this](char *data) { sid2 = data; });
-  observeProperty<char *, MPV_FORMAT_STRING>("audio-device", [this](char *data) { audioDevice = data; });
-  observeProperty<char *, MPV_FORMAT_STRING>("cursor-autohide", [this](char *data) { cursorAutohide = data; });
-
-  observeProperty<int, MPV_FORMAT_FLAG>("pause", [this](int flag) { pause = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("mute", [this](int flag) { mute = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("fullscreen", [this](int flag) { fullscreen = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("sub-visibility", [this](int flag) { sidv = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("secondary-sub-visibility", [this](int flag) { sidv2 = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("window-dragging", [this](int flag) { windowDragging = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("keepaspect", [this](int flag) { keepaspect = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("ontop", [this](int flag) { ontop = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("keepaspect-window", [this](int flag) { keepaspectWindow = flag; });
-  observeProperty<int, MPV_FORMAT_FLAG>("auto-window-resize", [this](int flag) { autoResize = flag; });
-
-  observeProperty<int64_t, MPV_FORMAT_INT64>("volume", [this](int64_t val) { volume = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("chapter", [this](int64_t val) { chapter = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("playlist-pos", [this](int64_t val) { playlistPos = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("playlist-playing-pos", [this](int64_t val) { playlistPlayingPos = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("time-pos", [this](int64_t val) { timePos = val; });
-
-  observeProperty<int64_t, MPV_FORMAT_INT64>("brightness", [this](int64_t val) { brightness = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("contrast", [this](int64_t val) { contrast = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("saturation", [this](int64_t val) { saturation = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("gamma", [this](int64_t val) { gamma = val; });
-  observeProperty<int64_t, MPV_FORMAT_INT64>("hue", [this](int64_t val) { hue = val; });
-
-  observeProperty<double, MPV_FORMAT_DOUBLE>("audio-delay", [this](double val) { audioDelay = val; });
-  observeProperty<double, MPV_FORMAT_DOUBLE>("sub-delay", [this](double val) { subDelay = val; });
-  observeProperty<double, MPV_FORMAT_DOUBLE>("sub-scale", [this](double val) { subScale = val; });
-}
-
-void Mpv::initPlaylist(mpv_node &node) {
+  observeState<mpv_node, MPV_FORMAT_NODE>("playlist", [](State &s, mpv_node node) { initPlaylist(s, node); });
+  observeState<mpv_node, MPV_FORMAT_NODE>("chapter-list", [](State &s, mpv_node node) { initChapters(s, node); });
+  observeState<mpv_node, MPV_FORMAT_NODE>("track-list", [](State &s, mpv_node node) { initTracks(s, node); });
+  observeState<mpv_node, MPV_FORMAT_NODE>("audio-device-list",
+                                          [](State &s, mpv_node node) { initAudioDevices(s, node); });
+  observeState<mpv_node, MPV_FORMAT_NODE>("input-bindings", [](State &s, mpv_node node) { initBindings(s, node); });
+  observeState<char *, MPV_FORMAT_STRING>("profile-list", [](State &s, char *data) { initProfiles(s, data); });
+
+  observeState<char *, MPV_FORMAT_STRING>("aid", [](State &s, char *data) { s.aid = data; });
+  observeState<char *, MPV_FORMAT_STRING>("vid", [](State &s, char *data) { s.vid = data; });
+  observeState<char *, MPV_FORMAT_STRING>("sid", [](State &s, char *data) { s.sid = data; });
+  observeState<char *, MPV_FORMAT_STRING>("secondary-sid", [](State &s, char *data) { s.sid2 = data; });
+  observeState<char *, MPV_FORMAT_STRING>("audio-device", [](State &s, char *data) { s.audioDevice = data; });
+  observeState<char *, MPV_FORMAT_STRING>("cursor-autohide", [](State &s, char *data) { s.cursorAutohide = data; });
+
+  observeState<int, MPV_FORMAT_FLAG>("pause", [](State &s, int flag) { s.pause = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("mute", [](State &s, int flag) { s.mute = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("fullscreen", [](State &s, int flag) { s.fullscreen = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("sub-visibility", [](State &s, int flag) { s.sidv = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("secondary-sub-visibility", [](State &s, int flag) { s.sidv2 = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("window-dragging", [](State &s, int flag) { s.windowDragging = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("keepaspect", [](State &s, int flag) { s.keepaspect = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("ontop", [](State &s, int flag) { s.ontop = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("keepaspect-window", [](State &s, int flag) { s.keepaspectWindow = flag; });
+  observeState<int, MPV_FORMAT_FLAG>("auto-window-resize", [](State &s, int flag) { s.autoResize = flag; });
+
+  observeState<int64_t, MPV_FORMAT_INT64>("volume", [](State &s, int64_t val) { s.volume = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("chapter", [](State &s, int64_t val) { s.chapter = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("playlist-pos", [](State &s, int64_t val) { s.playlistPos = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("playlist-playing-pos",
+                                          [](State &s, int64_t val) { s.playlistPlayingPos = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("time-pos", [](State &s, int64_t val) { s.timePos = val; });
+
+  observeState<int64_t, MPV_FORMAT_INT64>("brightness", [](State &s, int64_t val) { s.brightness = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("contrast", [](State &s, int64_t val) { s.contrast = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("saturation", [](State &s, int64_t val) { s.saturation = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("gamma", [](State &s, int64_t val) { s.gamma = val; });
+  observeState<int64_t, MPV_FORMAT_INT64>("hue", [](State &s, int64_t val) { s.hue = val; });
+
+  observeState<double, MPV_FORMAT_DOUBLE>("audio-delay", [](State &s, double val) { s.audioDelay = val; });
+  observeState<double, MPV_FORMAT_DOUBLE>("sub-delay", [](State &s, double val) { s.subDelay = val; });
+  observeState<double, MPV_FORMAT_DOUBLE>("sub-scale", [](State &s, double val) { s.subScale = val; });
+}
+
+// Entries are matched to the previous playlist by mpv's playlist entry id: unchanged, moved or retitled entries
+// reuse their strings in the shared arena, and the previous playlist is kept if nothing changed at all
+// (e.g. only the current entry did).
+void Mpv::initPlaylist(State &state, mpv_node &node) {
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
-  playlist.clear();
+  std::vector<Playlist::Entry> entries(node.u.list->num);
   for (int i = 0; i < node.u.list->num; i++) {
     auto item = node.u.list->values[i];
-    Mpv::PlayItem t;
-    t.id = i;
     for (int j = 0; j < item.u.list->num; j++) {
       auto key = item.u.list->keys[j];
       auto value = item.u.list->values[j];
-      if (strcmp(key, "title") == 0) {
-        t.title = value.u.string;
+      if (strcmp(key, "id") == 0) {
+        entries[i].entryId = value.u.int64;
+      } else if (strcmp(key, "title") == 0) {
+        entries[i].title = value.u.string;
       } else if (strcmp(key, "filename") == 0) {
-        t.path = reinterpret_cast<char8_t *>(value.u.string);
+        entries[i].filename = value.u.string;
       }
     }
-    playlist.emplace_back(t);
   }
+
+  auto &prev = *state.playlist;
+  bool changed = prev.size() != entries.size();
+  for (size_t i = 0; !changed && i < entries.size(); i++)
+    changed = entries[i].entryId < 0 || prev.entryId(i) != entries[i].entryId || prev.title(i) != entries[i].title;
+  if (changed) state.playlist = Playlist::build(entries, &prev);
 }
 
-void Mpv::initChapters(mpv_node &node) {
+// chapter and track lists are short, they are parsed in full but only replace the previous list when they differ
+void Mpv::initChapters(State &state, mpv_node &node) {
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
-  chapters.clear();
+  auto chapters = std::make_shared<std::vector<ChapterItem>>();
+  chapters->reserve(node.u.list->num);
   for (int i = 0; i < node.u.list->num; i++) {
     auto item = node.u.list->values[i];
     Mpv::ChapterItem t;
@@ -211,13 +763,15 @@ void Mpv::initChapters(mpv_node &node) {
         t.time = value.u.double_;
       }
     }
-    chapters.emplace_back(t);
+    chapters->emplace_back(t);
   }
+  if (*chapters != *state.chapters) state.chapters = chapters;
 }
 
-void Mpv::initTracks(mpv_node &node) {
+void Mpv::initTracks(State &state, mpv_node &node) {
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
-  tracks.clear();
+  auto tracks = std::make_shared<std::vector<TrackItem>>();
+  tracks->reserve(node.u.list->num);
   for (int i = 0; i < node.u.list->num; i++) {
     auto track = node.u.list->values[i];
     Mpv::TrackItem t;
@@ -236,13 +790,15 @@ void Mpv::initTracks(mpv_node &node) {
         t.selected = value.u.flag;
       }
     }
-    tracks.emplace_back(t);
+    tracks->emplace_back(t);
   }
+  if (*tracks != *state.tracks) state.tracks = tracks;
 }
 
-void Mpv::initAudioDevices(mpv_node &node) {
+void Mpv::initAudioDevices(State &state, mpv_node &node) {
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
-  audioDevices.clear();
+  auto audioDevices = std::make_shared<std::vector<AudioDevice>>();
+  audioDevices->reserve(node.u.list->num);
   for (int i = 0; i < node.u.list->num; i++) {
     auto item = node.u.list->values[i];
     Mpv::AudioDevice t;
@@ -255,13 +811,15 @@ void Mpv::initAudioDevices(mpv_node &node) {
         t.description = value.u.string;
       }
     }
-    audioDevices.emplace_back(t);
+    audioDevices->emplace_back(t);
   }
+  state.audioDevices = audioDevices;
 }
 
-void Mpv::initBindings(mpv_node &node) {
+void Mpv::initBindings(State &state, mpv_node &node) {
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
-  bindings.clear();
+  auto bindings = std::make_shared<std::vector<BindingItem>>();
+  bindings->reserve(node.u.list->num);
   for (int i = 0; i < node.u.list->num; i++) {
     auto item = node.u.list->values[i];
     Mpv::BindingItem t;
@@ -282,18 +840,20 @@ void Mpv::initBindings(mpv_node &node) {
         t.weak = value.u.flag;
       }
     }
-    bindings.emplace_back(t);
+    bindings->emplace_back(t);
   }
+  state.bindings = bindings;
 }
 
-void Mpv::initProfiles(const char *payload) {
+void Mpv::initProfiles(State &state, const char *payload) {
   if (payload == nullptr) return;
-  profiles.clear();
+  auto profiles = std::make_shared<std::vector<std::string>>();
   auto j = nlohmann::json::parse(payload);
   for (auto &elm : j) {
     auto name = elm["name"].get_ref<const std::string &>();
     if (name != "builtin-pseudo-gui" && name != "encoding" && name != "libmpv" && name != "pseudo-gui")
-      profiles.emplace_back(name);
+      profiles->emplace_back(name);
   }
+  state.profiles = profiles;
 }
 }  // namespace ImPlay
\ No newline at end of file
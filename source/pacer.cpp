@@ -0,0 +1,80 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cmath>
+#include "pacer.h"
+
+namespace ImPlay {
+void Pacer::setRefreshRate(int hz) {
+  if (hz <= 0) return;
+  nominal = 1000000 / hz;
+  interval = nominal;
+  stats.interval = nominal;
+}
+
+// when the video thread should start rendering a frame, so that it is ready one vsync ahead
+int64_t Pacer::renderTime(int64_t target) const {
+  if (target == 0) return 0;
+  return target - 2 * interval;
+}
+
+// the first vsync at or after now, extrapolated from the last swap; now if vsync is off
+int64_t Pacer::nextVsync(int64_t now) const {
+  int64_t period = interval;
+  if (!vsync || lastSwap == 0) return now;
+  return lastSwap + std::max<int64_t>(0, (now - lastSwap + period - 1) / period) * period;
+}
+
+bool Pacer::due(int64_t target, int64_t now) const {
+  if (target == 0) return true;
+  return target <= nextVsync(now) + interval / 2;
+}
+
+// time until the UI should start the frame that presents target
+int64_t Pacer::delay(int64_t target, int64_t now) const {
+  if (due(target, now)) return 0;
+  int64_t period = interval;
+  if (!vsync || lastSwap == 0) return target - period / 2 - now;
+
+  // wake shortly after the vsync preceding the one the frame belongs to
+  int64_t k = (target - period / 2 - lastSwap + period - 1) / period;
+  int64_t wake = lastSwap + (k - 1) * period + period / 8;
+  return wake > now ? wake - now : 0;
+}
+
+// called right after a swap returned, now is when the frame hit the screen if vsync is on
+void Pacer::swapped(int64_t now, bool vsync_) {
+  if (vsync_ && vsync && lastSwap > 0) {
+    int64_t delta = now - lastSwap;
+    // ignore swaps that were delayed by more than one vsync, or that did not block at all
+    if (delta > nominal / 2 && delta < nominal * 3 / 2) interval = (interval * 15 + delta) / 16;
+  }
+  vsync = vsync_;
+  lastSwap = now;
+  stats.interval = interval;
+}
+
+void Pacer::presented(int64_t target, int64_t now) {
+  double period = interval;
+  stats.frames++;
+  if (target == 0) {
+    lastTarget = 0;
+    return;
+  }
+
+  int64_t late = std::lround((now - target) / period);
+  if (late > 0)
+    stats.missed += late;
+  else
+    stats.onTime++;
+
+  if (lastTarget > 0 && target > lastTarget) {
+    int64_t expected = std::lround((target - lastTarget) / period);
+    int64_t actual = std::lround((now - lastPresent) / period);
+    if (actual > expected) stats.duplicated += actual - expected;
+  }
+  lastTarget = target;
+  lastPresent = now;
+}
+}  // namespace ImPlay
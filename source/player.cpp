@@ -20,11 +20,11 @@ Player::Player(Config *config) : config(config) {
   mpv = new Mpv();
 
   about = new Views::About();
-  debug = new Views::Debug(config, mpv);
-  quickview = new Views::Quickview(config, mpv);
+  debug = new Views::Debug(config, mpv, &metrics);
+  quickview = new Views::Quickview(config, mpv, &metrics);
   settings = new Views::Settings(config, mpv);
   contextMenu = new Views::ContextMenu(config, mpv);
-  commandPalette = new Views::CommandPalette(config, mpv);
+  commandPalette = new Views::CommandPalette(config, mpv, [this]() { wakeup(); });
 }
 
 Player::~Player() {
@@ -49,6 +49,7 @@ bool Player::init(std::map<std::string, std::string> &options) {
   // override-display-fps is renamed to display-fps-override in mpv 0.37.0
   mpv->option<int64_t, MPV_FORMAT_INT64>("override-display-fps", GetMonitorRefreshRate());
   mpv->option<int64_t, MPV_FORMAT_INT64>("display-fps-override", GetMonitorRefreshRate());
+  pacer.setRefreshRate(GetMonitorRefreshRate());
 
   if (!config->Data.Mpv.UseConfig) {
     writeMpvConf();
@@ -67,11 +68,12 @@ bool Player::init(std::map<std::string, std::string> &options) {
 
   debug->init();
 
-  {
-    ContextGuard guard(this);
-    logoTexture = ImGui::LoadTexture("icon.png");
-    mpv->init(GetGLAddrFunc(), GetWid());
-  }
+  // the mpv render context belongs to the video thread's shared context
+  mpv->updateCb() = [this](Mpv *ctx) { videoNotifier.notify(); };
+  logoTexture = ImGui::LoadTexture("icon.png");
+  MakeVideoContextCurrent();
+  mpv->init(GetGLAddrFunc(), GetWid());
+  MakeContextCurrent();
 
   SetWindowDecorated(mpv->property<int, MPV_FORMAT_FLAG>("border"));
   mpv->property<int64_t, MPV_FORMAT_INT64>("volume", config->Data.Mpv.Volume);
@@ -100,8 +102,11 @@ void Player::drawVideo() {
   auto drawList = ImGui::GetBackgroundDrawList(vp);
 
   if (!idle) {
-    drawList->AddImage((ImTextureID)(intptr_t)tex, vp->WorkPos, vp->WorkPos + vp->WorkSize);
-  } else if (logoTexture != 0 && !mpv->forceWindow) {
+    if (videoValid) {
+      auto tex = videoTargets[videoRead].tex;
+      drawList->AddImage((ImTextureID)(intptr_t)tex, vp->WorkPos, vp->WorkPos + vp->WorkSize);
+    }
+  } else if (logoTexture != 0 && !mpv->state()->forceWindow) {
     const ImVec2 center = vp->GetWorkCenter();
     const ImVec2 delta(64, 64);
     drawList->AddImage(logoTexture, center - delta, center + delta);
@@ -112,87 +117,259 @@ void Player::render() {
   auto g = ImGui::GetCurrentContext();
   if (g != nullptr && g->WithinFrameScope) return;
 
-  {
-    ContextGuard guard(this);
+  acquireVideoFrame();
 
-    if (idle) {
-      glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-      glClearColor(0, 0, 0, 1);
-      glClear(GL_COLOR_BUFFER_BIT);
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    }
+  // nothing changed since the last frame: keep the presented image, skip the ImGui pass and the swap
+  if (config->FontReload || commandPalette->pending()) invalidate();
+  if (dirtyFrames == 0) {
+    metrics.frames.skipped++;
+    return;
+  }
+  dirtyFrames--;
+  metrics.frames.rendered++;
+  Metrics::Probe frameProbe(&metrics, Metrics::PHASE_FRAME);
 
+  {
+    Metrics::Probe probe(&metrics, Metrics::PHASE_NEW_FRAME);
     if (config->FontReload) {
       loadFonts();
       config->FontReload = false;
     }
     ImGui_ImplOpenGL3_NewFrame();
-  }
 
-  BackendNewFrame();
-  ImGui::NewFrame();
+    BackendNewFrame();
+    ImGui::NewFrame();
 
 #if defined(_WIN32) && defined(IMGUI_HAS_VIEWPORT)
-  if (config->Data.Mpv.UseWid) {
-    ImGuiViewport *vp = ImGui::GetMainViewport();
-    vp->Flags &= ~ImGuiViewportFlags_CanHostOtherWindows;  // HACK: disable main viewport merge
-  }
+    if (config->Data.Mpv.UseWid) {
+      ImGuiViewport *vp = ImGui::GetMainViewport();
+      vp->Flags &= ~ImGuiViewportFlags_CanHostOtherWindows;  // HACK: disable main viewport merge
+    }
 #endif
 
-  draw();
+    draw();
 
 #if defined(_WIN32) && defined(IMGUI_HAS_VIEWPORT)
-  if (config->Data.Mpv.UseWid && mpv->ontop) {
-    ImGuiContext *ctx = ImGui::GetCurrentContext();
-    for (int i = 1; i < ctx->Windows.Size; i++) {
-      ImGuiWindow *w = ctx->Windows[i];
-      if (w->Flags & ImGuiWindowFlags_Popup) {  // HACK: make all popup topmost
-        w->WindowClass.ViewportFlagsOverrideSet = ImGuiViewportFlags_TopMost;
+    if (config->Data.Mpv.UseWid && mpv->state()->ontop) {
+      ImGuiContext *ctx = ImGui::GetCurrentContext();
+      for (int i = 1; i < ctx->Windows.Size; i++) {
+        ImGuiWindow *w = ctx->Windows[i];
+        if (w->Flags & ImGuiWindowFlags_Popup) {  // HACK: make all popup topmost
+          w->WindowClass.ViewportFlagsOverrideSet = ImGuiViewportFlags_TopMost;
+        }
       }
     }
-  }
 #endif
+  }
+
+  {
+    Metrics::Probe probe(&metrics, Metrics::PHASE_RENDER);
+    ImGui::Render();
+  }
 
-  ImGui::Render();
+  GetFramebufferSize(&width, &height);
+  if (auto size = surface.load(); size->width != width || size->height != height)
+    surface.store(std::make_shared<const Surface>(Surface{width, height}));
+  glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer());
+  glViewport(0, 0, width, height);
 
   {
-    ContextGuard guard(this);
-    GetFramebufferSize(&width, &height);
-    glViewport(0, 0, width, height);
+    Metrics::Probe probe(&metrics, Metrics::PHASE_COMPOSITE);
+    // nothing but the video is visible: copy it to the window, skipping the clear and the composite pass
+    auto drawData = ImGui::GetDrawData();
+    auto bgDrawList = ImGui::GetBackgroundDrawList(ImGui::GetMainViewport());
+    if (videoValid && !idle && ImGui::IsDrawListOnly(drawData, bgDrawList)) {
+      blitVideo();
+      metrics.frames.direct++;
+    } else {
+      glClearColor(0, 0, 0, 1);
+      glClear(GL_COLOR_BUFFER_BIT);
 
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT);
+      ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    }
+    if (videoValid) fenceSync(videoTargets[videoRead].fence);
+  }
 
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    SetSwapInterval(config->Data.Interface.Fps > 60 ? 0 : 1);
+  bool vsync = config->Data.Interface.Fps <= 60;
+  SetSwapInterval(vsync ? 1 : 0);
+  {
+    Metrics::Probe probe(&metrics, Metrics::PHASE_SWAP);
     SwapBuffers();
-    mpv->reportSwap();
+  }
+  mpv->reportSwap();
+
+  int64_t now = mpv->time();
+  pacer.swapped(now, vsync);
+  if (videoPresenting) pacer.presented(videoTargets[videoRead].target, now);
+  videoPresenting = false;
 
 #ifdef IMGUI_HAS_VIEWPORT
-    if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
-      ImGui::UpdatePlatformWindows();
-      ImGui::RenderPlatformWindowsDefault();
-    }
-#endif
+  if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+    ImGui::UpdatePlatformWindows();
+    ImGui::RenderPlatformWindowsDefault();
+    MakeContextCurrent();
   }
+#endif
+}
+
+void Player::startVideo() {
+  videoShutdown = false;
+  videoThread = std::thread([this]() {
+    MakeVideoContextCurrent();
+    while (!videoShutdown) {
+      videoNotifier.wait();
+      if (videoShutdown) break;
+
+      if (mpv->wantRender()) {
+        // render shortly before the frame is due, and don't replace one that is still waiting for its vsync
+        int64_t renderAt = videoRenderTime();
+        while (!videoShutdown) {
+          int64_t wait = renderAt - mpv->time();
+          if (videoQueued())
+            videoNotifier.wait();  // notified by the UI when it takes the frame
+          else if (wait > 0)
+            videoNotifier.wait_until(std::chrono::steady_clock::now() + std::chrono::microseconds(wait));
+          else
+            break;
+        }
+        if (videoShutdown) break;
+
+        renderVideo();
+        wakeup();
+      }
+    }
+    exitVideo();
+    DeleteContext();
+  });
 }
 
+void Player::stopVideo() {
+  videoShutdown = true;
+  videoNotifier.notify();
+  if (videoThread.joinable()) videoThread.join();
+}
+
+// called on the video thread, with the shared video context current
 void Player::renderVideo() {
-  ContextGuard guard(this);
+  Metrics::Probe probe(&metrics, Metrics::PHASE_VIDEO);
+  auto size = surface.load();
+  if (size->width <= 0 || size->height <= 0) return;  // nothing rendered yet, or minimized
+  auto &target = videoTargets[videoWrite];
+  waitSync(target.fence);  // the UI may still be sampling it
+  if (target.width != size->width || target.height != size->height) target.alloc(size->width, size->height);
+  mpv->render(target.width, target.height, target.fbo, false);
+  fenceSync(target.fence);
+  target.target = videoNextTarget;
+
+  videoWrite = videoReady.exchange(videoWrite | VIDEO_FRESH) & ~VIDEO_FRESH;
+}
+
+// called on the video thread before it releases the shared video context
+void Player::exitVideo() {
+  for (auto &target : videoTargets) target.destroy();
+  mpv->freeRender();
+}
+
+void Player::blitVideo() {
+  auto &target = videoTargets[videoRead];
+  bool scale = target.width != width || target.height != height;
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, blitFbo);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.tex, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GetFramebuffer());
+  // the video is rendered top-down, the window framebuffer is bottom-up
+  glBlitFramebuffer(0, 0, target.width, target.height, 0, height, width, 0, GL_COLOR_BUFFER_BIT,
+                    scale ? GL_LINEAR : GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer());
+}
+
+// called on the video thread before waiting for the next frame's render time
+int64_t Player::videoRenderTime() {
+  videoNextTarget = mpv->nextFrameTime();
+  return pacer.renderTime(videoNextTarget);
+}
+
+// whether a published frame is still waiting for its vsync, the video thread must not overwrite it
+bool Player::videoQueued() {
+  int ready = videoReady.load();
+  if ((ready & VIDEO_FRESH) == 0) return false;
+  return videoTargets[ready & ~VIDEO_FRESH].target > mpv->time();
+}
+
+// seconds until the UI should render to present the pending video frame, -1 if there is none
+double Player::videoDelay() {
+  int ready = videoReady.load();
+  if ((ready & VIDEO_FRESH) == 0) return -1;
+  return pacer.delay(videoTargets[ready & ~VIDEO_FRESH].target, mpv->time()) / 1e6;
+}
+
+// pick up the latest video frame, unless it is meant for a later vsync
+void Player::acquireVideoFrame() {
+  int ready = videoReady.load();
+  if ((ready & VIDEO_FRESH) == 0) return;
+  if (!pacer.due(videoTargets[ready & ~VIDEO_FRESH].target, mpv->time())) return;
+  videoRead = videoReady.exchange(videoRead) & ~VIDEO_FRESH;
+  videoNotifier.notify();  // the video thread may be holding the next frame back for this one
+  waitSync(videoTargets[videoRead].fence);  // GPU-side wait for the video thread's rendering
+  videoValid = true;
+  videoPresenting = true;
+  invalidate(1);
+}
+
+// Sync objects are shared between the two contexts, fall back to glFinish if they are not supported.
+void Player::fenceSync(GLsync &sync) {
+  if (sync != nullptr) glDeleteSync(sync);
+  if (glFenceSync == nullptr) {
+    Metrics::Probe probe(&metrics, Metrics::PHASE_SYNC);
+    sync = nullptr;
+    glFinish();
+    return;
+  }
+  sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+}
 
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glBindTexture(GL_TEXTURE_2D, tex);
+void Player::waitSync(GLsync &sync) {
+  if (sync == nullptr) return;
+  glWaitSync(sync, 0, GL_TIMEOUT_IGNORED);
+  glDeleteSync(sync);
+  sync = nullptr;
+}
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+void Player::VideoTarget::alloc(int w, int h) {
+  if (tex != 0) glDeleteTextures(1, &tex);
+  if (fbo == 0) glGenFramebuffers(1, &fbo);
+  glGenTextures(1, &tex);
 
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+#ifdef IMGUI_IMPL_OPENGL_ES3
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
+#else
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#endif
   glBindTexture(GL_TEXTURE_2D, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-  mpv->render(width, height, fbo, false);
+  width = w;
+  height = h;
+}
+
+void Player::VideoTarget::destroy() {
+  if (fence != nullptr) glDeleteSync(fence);
+  if (tex != 0) glDeleteTextures(1, &tex);
+  if (fbo != 0) glDeleteFramebuffers(1, &fbo);
+  fence = nullptr;
+  tex = fbo = 0;
+  width = height = 0;
 }
 
 void Player::initGui() {
-  ContextGuard guard(this);
+  MakeContextCurrent();  // the UI thread keeps its context current from now on
 
 #ifdef IMGUI_IMPL_OPENGL_ES3
   if (!gladLoadGLES2((GLADloadfunc)GetGLAddrFunc())) throw std::runtime_error("Failed to load GLES 2!");
@@ -216,20 +393,7 @@ void Player::initGui() {
 #endif
 
   loadFonts();
-
-  glGenFramebuffers(1, &fbo);
-  glGenTextures(1, &tex);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-  glBindTexture(GL_TEXTURE_2D, tex);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glGenFramebuffers(1, &blitFbo);
 
 #ifdef IMGUI_IMPL_OPENGL_ES3
   ImGui_ImplOpenGL3_Init("#version 300 es");
@@ -243,9 +407,8 @@ void Player::initGui() {
 void Player::exitGui() {
   MakeContextCurrent();
 
+  glDeleteFramebuffers(1, &blitFbo);
   ImGui_ImplOpenGL3_Shutdown();
-  glDeleteTextures(1, &tex);
-  glDeleteFramebuffers(1, &fbo);
 
   ImGui::DestroyContext();
 }
@@ -255,7 +418,7 @@ void Player::saveState() {
     GetWindowPos(&config->Data.Window.X, &config->Data.Window.Y);
     GetWindowSize(&config->Data.Window.W, &config->Data.Window.H);
   }
-  config->Data.Mpv.Volume = mpv->volume;
+  config->Data.Mpv.Volume = mpv->state()->volume;
   config->save();
 }
 
@@ -322,21 +485,51 @@ void Player::loadFonts() {
 void Player::shutdown() { mpv->command(config->Data.Mpv.WatchLater ? "quit-watch-later" : "quit"); }
 
 void Player::onCursorEvent(double x, double y) {
-  std::string xs = std::to_string((int)x);
-  std::string ys = std::to_string((int)y);
-  mpv->commandv("mouse", xs.c_str(), ys.c_str(), nullptr);
+  input.moved = true;
+  input.x = (int)x;
+  input.y = (int)y;
 }
 
 void Player::onScrollEvent(double x, double y) {
-  if (abs(x) > 0) onKeyEvent(x > 0 ? "WHEEL_LEFT" : "WHEEL_RIGH");
-  if (abs(y) > 0) onKeyEvent(y > 0 ? "WHEEL_UP" : "WHEEL_DOWN");
+  input.scrollX += x;
+  input.scrollY += y;
+}
+
+void Player::onKeyEvent(const char *name) {
+  flushInput();
+  mpv->commandv("keypress", name, nullptr);
 }
 
-void Player::onKeyEvent(std::string name) { mpv->commandv("keypress", name.c_str(), nullptr); }
+void Player::onKeyDownEvent(const char *name) {
+  flushInput();
+  mpv->commandv("keydown", name, nullptr);
+}
+
+void Player::onKeyUpEvent(const char *name) {
+  flushInput();
+  mpv->commandv("keyup", name, nullptr);
+}
 
-void Player::onKeyDownEvent(std::string name) { mpv->commandv("keydown", name.c_str(), nullptr); }
+void Player::flushInput() {
+  if (input.moved) {
+    input.moved = false;
+    char xs[16], ys[16];
+    std::snprintf(xs, sizeof(xs), "%d", input.x);
+    std::snprintf(ys, sizeof(ys), "%d", input.y);
+    mpv->commandv("mouse", xs, ys, nullptr);
+  }
 
-void Player::onKeyUpEvent(std::string name) { mpv->commandv("keyup", name.c_str(), nullptr); }
+  // A wheel notch is 1.0, smaller deltas from touchpads carry over until they add up to a step. At most 10
+  // steps are sent per frame, the rest go out on the next one.
+  auto wheel = [this](double &delta, const char *positive, const char *negative) {
+    int steps = std::clamp((int)delta, -10, 10);
+    delta -= steps;
+    for (int i = 0; i < std::abs(steps); i++) mpv->commandv("keypress", steps > 0 ? positive : negative, nullptr);
+    if (std::abs(delta) >= 1) wakeup();
+  };
+  wheel(input.scrollX, "WHEEL_LEFT", "WHEEL_RIGHT");
+  wheel(input.scrollY, "WHEEL_UP", "WHEEL_DOWN");
+}
 
 void Player::onDropEvent(int count, const char **paths) {
   std::sort(paths, paths + count, [](const auto &a, const auto &b) { return strnatcasecmp(a, b) < 0; });
@@ -345,31 +538,43 @@ void Player::onDropEvent(int count, const char **paths) {
   load(files);
 }
 
+// queries the video size asynchronously, the handler runs with the size once both replies arrived
+static void videoSize(Mpv *mpv, std::function<void(int, int)> handler) {
+  mpv->propertyAsync<int64_t, MPV_FORMAT_INT64>("dwidth", [=](int64_t width) {
+    mpv->propertyAsync<int64_t, MPV_FORMAT_INT64>("dheight",
+                                                  [=](int64_t height) { handler((int)width, (int)height); });
+  });
+}
+
 void Player::updateWindowState() {
-  int width = (int)mpv->property<int64_t, MPV_FORMAT_INT64>("dwidth");
-  int height = (int)mpv->property<int64_t, MPV_FORMAT_INT64>("dheight");
-  if (width > 0 && height > 0) {
+  videoSize(mpv, [this](int width, int height) {
+    if (width <= 0 || height <= 0) return;
+    auto state = mpv->state();
     int x, y, w, h;
     GetWindowPos(&x, &y);
     GetWindowSize(&w, &h);
-    if ((w != width || h != height) && mpv->autoResize) {
+    if ((w != width || h != height) && state->autoResize) {
       SetWindowSize(width, height);
       SetWindowPos(x + (w - width) / 2, y + (h - height) / 2);
     }
-    if (mpv->keepaspect && mpv->keepaspectWindow) SetWindowAspectRatio(width, height);
-  }
+    if (state->keepaspect && state->keepaspectWindow) SetWindowAspectRatio(width, height);
+  });
 }
 
 void Player::initObservers() {
   mpv->observeEvent(MPV_EVENT_SHUTDOWN, [this](void *data) { SetWindowShouldClose(true); });
 
   mpv->observeEvent(MPV_EVENT_VIDEO_RECONFIG, [this](void *data) {
-    if (!mpv->fullscreen) updateWindowState();
+    if (!mpv->state()->fullscreen) updateWindowState();
   });
 
   mpv->observeEvent(MPV_EVENT_FILE_LOADED, [this](void *data) {
-    auto path = mpv->property("path");
-    if (path != "" && path != "bd://" && path != "dvd://") config->addRecentFile(path, mpv->property("media-title"));
+    mpv->propertyAsync<char *, MPV_FORMAT_STRING>("path", [this](char *data) {
+      std::string path = data;
+      if (path == "" || path == "bd://" || path == "dvd://") return;
+      mpv->propertyAsync<char *, MPV_FORMAT_STRING>(
+          "media-title", [this, path](char *title) { config->addRecentFile(path, title); });
+    });
     mpv->property("force-media-title", "");
     mpv->property("start", "none");
   });
@@ -382,6 +587,7 @@ void Player::initObservers() {
   mpv->observeProperty<int, MPV_FORMAT_FLAG>("idle-active", [this](int flag) {
     idle = static_cast<bool>(flag);
     if (idle) {
+      videoValid = false;
       SetWindowTitle(PLAYER_NAME);
       SetWindowAspectRatio(-1, -1);
     }
@@ -393,9 +599,9 @@ void Player::initObservers() {
   mpv->observeProperty<int, MPV_FORMAT_FLAG>("window-maximized", [this](int flag) { SetWindowMaximized(flag); });
   mpv->observeProperty<int, MPV_FORMAT_FLAG>("window-minimized", [this](int flag) { SetWindowMinimized(flag); });
   mpv->observeProperty<double, MPV_FORMAT_DOUBLE>("window-scale", [this](double scale) {
-    int w = (int)mpv->property<int64_t, MPV_FORMAT_INT64>("dwidth");
-    int h = (int)mpv->property<int64_t, MPV_FORMAT_INT64>("dheight");
-    if (w > 0 && h > 0) SetWindowSize((int)(w * scale), (int)(h * scale));
+    videoSize(mpv, [this, scale](int w, int h) {
+      if (w > 0 && h > 0) SetWindowSize((int)(w * scale), (int)(h * scale));
+    });
   });
   mpv->observeProperty<int, MPV_FORMAT_FLAG>("fullscreen", [this](int flag) { SetWindowFullscreen(flag); });
 }
@@ -464,10 +670,10 @@ void Player::execute(int n_args, const char **args_) {
       {"playlist-add-files", [&](int n, const char **args) { openFilesDlg(mediaFilters, true); }},
       {"playlist-add-folder", [&](int n, const char **args) { openFolderDlg(true); }},
       {"playlist-sort", [&](int n, const char **args) { playlistSort(n > 0 && strcmp(args[0], "true") == 0); }},
+      {"scan-cancel", [&](int n, const char **args) { cancelScan(); }},
       {"play-pause",
        [&](int n, const char **args) {
-         auto count = mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-count");
-         if (count > 0)
+         if (!mpv->state()->playlist->empty())
            mpv->command("cycle pause");
          else if (config->getRecentFiles().size() > 0) {
            for (auto &file : config->getRecentFiles()) {
@@ -542,69 +748,191 @@ void Player::openBluray(std::filesystem::path path) {
   mpv->commandv("loadfile", "bd://", nullptr);
 }
 
+// Applied with playlist-move when few entries change places, so the current file keeps playing. Larger
+// reorders reload the list, resuming the current file where it was.
 void Player::playlistSort(bool reverse) {
-  if (mpv->playlist.empty()) return;
-  std::vector<Mpv::PlayItem> items(mpv->playlist);
-  std::sort(items.begin(), items.end(), [&](const auto &a, const auto &b) {
-    std::string str1 = a.title != "" ? a.title : a.filename();
-    std::string str2 = b.title != "" ? b.title : b.filename();
-    return strnatcasecmp(str1.c_str(), str2.c_str()) < 0;
-  });
-  if (reverse) std::reverse(items.begin(), items.end());
+  auto state = mpv->state();
+  auto &list = *state->playlist;
+  if (list.empty()) return;
+  NaturalSort sort;
+  sort.reserve(list.size());
+  for (size_t i = 0; i < list.size(); i++) {
+    auto title = list.title(i);
+    sort.add(title.empty() ? list[i].name : title);
+  }
+  auto order = sort.sort(reverse);
+
+  if (auto moves = NaturalSort::moves(order, MAX_SORT_MOVES)) {
+    for (auto [from, to] : *moves)
+      mpv->commandv("playlist-move", std::to_string(from).c_str(), std::to_string(to).c_str(), nullptr);
+    return;
+  }
 
-  int64_t timePos = mpv->timePos;
+  int64_t timePos = state->timePos;
   int64_t pos = -1;
-  for (int i = 0; i < items.size(); i++) {
-    if (items[i].id == mpv->playlistPos) {
+  for (int i = 0; i < order.size(); i++) {
+    if (order[i] == state->playlistPos) {
       pos = i;
       break;
     }
   }
-  std::vector<std::string> playlist = {"#EXTM3U"};
-  for (auto &item : items) {
-    if (item.title != "") playlist.push_back(fmt::format("#EXTINF:-1,{}", item.title));
-    playlist.push_back(item.path.string());
+  std::vector<std::string> paths;
+  std::vector<std::string_view> titles;
+  paths.reserve(order.size());
+  titles.reserve(order.size());
+  for (auto i : order) {
+    auto item = list[i];
+    paths.push_back(item.path());
+    titles.push_back(item.title);
   }
   mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-start", pos);
   mpv->property("start", fmt::format("+{}", timePos).c_str());
-  if (!mpv->playing()) mpv->command("playlist-clear");
-  mpv->commandv("loadlist", fmt::format("memory://{}", join(playlist, "\n")).c_str(),
-                mpv->playing() ? "replace" : "append", nullptr);
+  if (!state->playing()) mpv->command("playlist-clear");
+  loadList(paths, state->playing() ? "replace" : "append", titles);
 }
 
+// Files are added with one loadlist per batch. Folders are listed by the scanner in the background and
+// their files streamed into the playlist by updateScan, so playback starts with the first file found. All
+// files and folders of a call that has folders go into one scan, and what is appended during a scan is
+// queued behind it, so the playlist keeps the given order.
 void Player::load(std::vector<std::filesystem::path> files, bool append, bool disk) {
-  int i = 0;
+  if (!append) cancelScan();
+  std::vector<std::filesystem::path> roots;
+  bool folders = false;
+  size_t loaded = 0;  // files and folders sent before the batch
+  auto flush = [&]() {
+    if (roots.empty()) return;
+    const char *action = append ? "append" : (loaded > 0 ? "append-play" : "replace");
+    loaded += roots.size();
+    if (scan.active) {
+      scan.queued.insert(scan.queued.end(), roots.begin(), roots.end());
+    } else if (folders) {
+      startScan(roots, action);
+    } else {
+      std::vector<std::string> paths;
+      for (auto &root : roots) paths.push_back(root.string());
+      loadList(paths, action);
+    }
+    roots.clear();
+    folders = false;
+  };
   for (auto &file : files) {
     if (std::filesystem::is_directory(file)) {
       if (disk) {
+        flush();
         if (std::filesystem::exists(file / u8"BDMV"))
           openBluray(file);
         else
           openDvd(file);
         break;
       }
-      for (const auto &entry : std::filesystem::recursive_directory_iterator(file)) {
-        auto path = entry.path().string();
-        if (isMediaFile(path)) {
-          const char *action = append ? "append" : (i > 0 ? "append-play" : "replace");
-          mpv->commandv("loadfile", path.c_str(), action, nullptr);
-          i++;
-        }
-      }
+      roots.push_back(file);
+      folders = true;
     } else {
       if (file.extension() == ".iso") {
+        flush();
         if ((double)std::filesystem::file_size(file) / 1000 / 1000 / 1000 > 4.7)
           openBluray(file);
         else
           openDvd(file);
         break;
-      } else if (isSubtitleFile(file.string())) {
+      } else if (Media::classify(file, true) == Media::Type::Subtitle) {
+        if (!folders) flush();  // files before it are loaded first, folders wait for the rest of the call
         mpv->commandv("sub-add", file.string().c_str(), append ? "auto" : "select", nullptr);
       } else {
-        const char *action = append ? "append" : (i > 0 ? "append-play" : "replace");
-        mpv->commandv("loadfile", file.string().c_str(), action, nullptr);
+        roots.push_back(file);
       }
-      i++;
+    }
+  }
+  flush();
+}
+
+// a path with a protocol prefix, like http:// or dvd://
+static bool isUrl(const std::string &path) {
+  auto sep = path.find("://");
+  if (sep == std::string::npos || sep == 0) return false;
+  for (size_t i = 0; i < sep; i++)
+    if (!std::isalnum((uint8_t)path[i]) && path[i] != '+' && path[i] != '.' && path[i] != '-') return false;
+  return true;
+}
+
+// Adds files with one loadlist per run of entries M3U can hold: a path starting with '#' or containing a
+// line break is added with loadfile in between, without its title. Paths are made absolute, since mpv
+// resolves relative entries of a memory:// playlist against the playlist instead of the working directory.
+void Player::loadList(const std::vector<std::string> &paths, const char *action,
+                      const std::vector<std::string_view> &titles) {
+  constexpr std::string_view header = "memory://#EXTM3U";
+  std::string list(header);
+  auto flush = [&]() {
+    if (list.size() == header.size()) return;
+    mpv->commandv("loadlist", list.c_str(), action, nullptr);
+    list.resize(header.size());
+    action = "append";
+  };
+  for (size_t i = 0; i < paths.size(); i++) {
+    std::string path = paths[i];
+    if (!isUrl(path)) {
+      std::error_code ec;
+      auto absolute = std::filesystem::absolute(path, ec);
+      if (!ec) path = absolute.string();
+    }
+    if (path.starts_with('#') || path.find_first_of("\r\n") != std::string::npos) {
+      flush();
+      mpv->commandv("loadfile", path.c_str(), action, nullptr);
+      action = "append";
+      continue;
+    }
+    if (i < titles.size() && !titles[i].empty()) {
+      std::string title(titles[i]);
+      std::replace_if(title.begin(), title.end(), [](char c) { return c == '\r' || c == '\n'; }, ' ');
+      list.append("\n#EXTINF:-1,").append(title);
+    }
+    list.append("\n").append(path);
+  }
+  flush();
+}
+
+void Player::startScan(const std::vector<std::filesystem::path> &roots, const char *action) {
+  scan.active = true;
+  scan.action = action;
+  scan.files = 0;
+  // extensionless files are sniffed, the rest is told apart by name
+  scanner.start(roots, [](const std::filesystem::path &path) {
+    return Media::isMedia(Media::classify(path, !path.has_extension()));
+  });
+}
+
+void Player::cancelScan() {
+  scanner.cancel();
+  scan = {};
+}
+
+void Player::updateScan() {
+  if (!scan.active) return;
+  auto progress = scanner.progress();
+  std::vector<std::string> files;
+  scanner.take(files);
+
+  if (!files.empty()) {
+    loadList(files, scan.files == 0 ? scan.action : "append");
+    // the first batch starts playback, don't cover the playing message
+    if (scan.files > 0 && !progress.done) {
+      size_t count = scan.files + files.size();
+      auto msg = i18n_a("views.scan.progress", count, progress.dirs);
+      mpv->commandv("show-text", msg.c_str(), nullptr);
+    }
+    scan.files += files.size();
+  }
+  if (progress.done) {
+    if (scan.files > 0 && scan.files != files.size()) {
+      auto msg = i18n_a("views.scan.done", scan.files);
+      mpv->commandv("show-text", msg.c_str(), nullptr);
+    }
+    scan.active = false;
+    if (!scan.queued.empty()) {
+      auto roots = std::move(scan.queued);
+      scan.queued.clear();
+      startScan(roots, "append");
     }
   }
 }
@@ -666,22 +994,4 @@ void Player::messageBox(std::string title, std::string msg) {
   m_dialog_msg = msg;
   m_dialog = true;
 }
-
-bool Player::isMediaFile(std::string file) {
-  auto ext = std::filesystem::path(file).extension().string();
-  if (ext.empty()) return false;
-  if (ext[0] == '.') ext = ext.substr(1);
-  if (std::find(videoTypes.begin(), videoTypes.end(), ext) != videoTypes.end()) return true;
-  if (std::find(audioTypes.begin(), audioTypes.end(), ext) != audioTypes.end()) return true;
-  if (std::find(imageTypes.begin(), imageTypes.end(), ext) != imageTypes.end()) return true;
-  return false;
-}
-
-bool Player::isSubtitleFile(std::string file) {
-  auto ext = std::filesystem::path(file).extension().string();
-  if (ext.empty()) return false;
-  if (ext[0] == '.') ext = ext.substr(1);
-  if (std::find(subtitleTypes.begin(), subtitleTypes.end(), ext) != subtitleTypes.end()) return true;
-  return false;
-}
 }  // namespace ImPlay
\ No newline at end of file
@@ -0,0 +1,115 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <cstring>
+#include <unordered_set>
+#include "playlist.h"
+
+namespace ImPlay {
+Playlist::Str Playlist::Arena::add(std::string_view s) {
+  if (s.empty() || overflow) return {};
+
+  uint64_t offset = used;
+  if ((offset & CHUNK_MASK) + s.size() > CHUNK_MASK + 1) offset = (offset + CHUNK_MASK) & ~(uint64_t)CHUNK_MASK;
+  size_t chunk = offset >> CHUNK_BITS;
+  size_t count = ((offset & CHUNK_MASK) + s.size() + CHUNK_MASK) >> CHUNK_BITS;  // chunks the string spans
+  if (chunk + count > chunks.size()) {
+    overflow = true;
+    return {};
+  }
+  if (chunks[chunk] == nullptr) {  // at a chunk boundary, the chunks from here on are not allocated yet
+    blocks.emplace_back(new char[count << CHUNK_BITS]);
+    for (size_t i = 0; i < count; i++) chunks[chunk + i] = blocks.back().get() + (i << CHUNK_BITS);
+  }
+
+  std::memcpy(chunks[chunk] + (offset & CHUNK_MASK), s.data(), s.size());
+  used = (uint32_t)(offset + s.size());
+  return {(uint32_t)offset, (uint32_t)s.size()};
+}
+
+Playlist::Str Playlist::Arena::intern(std::string_view s) {
+  if (s.empty()) return {};
+  if (auto it = interned.find(s); it != interned.end()) return it->second;
+  auto str = add(s);
+  interned.emplace(get(str), str);
+  return str;
+}
+
+std::shared_ptr<const Playlist> Playlist::build(const std::vector<Entry> &entries, const Playlist *prev) {
+  // start over with a fresh arena once less than half of it is still referenced, or once it is full
+  bool reuse = prev != nullptr && prev->arena != nullptr && !prev->arena->full() &&
+               prev->arena->bytes() <= 2 * prev->liveBytes + (1 << 20);
+  auto list = build(entries, prev, reuse);
+  if (reuse && list->arena->full()) list = build(entries, prev, false);
+  return list;
+}
+
+std::shared_ptr<Playlist> Playlist::build(const std::vector<Entry> &entries, const Playlist *prev, bool reuse) {
+  auto list = std::make_shared<Playlist>();
+  size_t n = entries.size();
+  list->entryIds.reserve(n);
+  list->dirs.reserve(n);
+  list->names.reserve(n);
+  list->titles.reserve(n);
+  list->arena = reuse ? prev->arena : std::make_shared<Arena>();
+  auto &arena = *list->arena;
+
+  std::unordered_map<int64_t, size_t> previous;
+  if (prev != nullptr) {
+    previous.reserve(prev->size());
+    for (size_t i = 0; i < prev->size(); i++)
+      if (prev->entryIds[i] >= 0) previous.emplace(prev->entryIds[i], i);
+  }
+
+  std::unordered_set<uint32_t> counted;  // offsets of the directories in liveBytes
+  for (auto &entry : entries) {
+    Str dir, name, title;
+    auto it = entry.entryId >= 0 ? previous.find(entry.entryId) : previous.end();
+    if (it != previous.end()) {
+      size_t i = it->second;
+      if (reuse) {
+        dir = prev->dirs[i];
+        name = prev->names[i];
+      } else {
+        dir = arena.intern(prev->arena->get(prev->dirs[i]));
+        name = arena.add(prev->arena->get(prev->names[i]));
+      }
+      auto oldTitle = prev->arena->get(prev->titles[i]);
+      title = reuse && oldTitle == entry.title ? prev->titles[i] : arena.add(entry.title);
+    } else {
+      auto sep = entry.filename.find_last_of("/\\");
+      size_t split = sep == std::string_view::npos ? 0 : sep + 1;
+      dir = arena.intern(entry.filename.substr(0, split));
+      name = arena.add(entry.filename.substr(split));
+      title = arena.add(entry.title);
+    }
+
+    list->entryIds.push_back(entry.entryId);
+    list->dirs.push_back(dir);
+    list->names.push_back(name);
+    list->titles.push_back(title);
+    list->liveBytes += name.size + title.size;
+    if (dir.size > 0 && counted.insert(dir.offset).second) list->liveBytes += dir.size;
+  }
+  return list;
+}
+
+Playlist::Item Playlist::operator[](size_t i) const {
+  return {
+      (int64_t)i,
+      entryIds[i],
+      arena->get(titles[i]),
+      arena->get(dirs[i]),
+      arena->get(names[i]),
+  };
+}
+
+std::string_view Playlist::title(size_t i) const { return arena->get(titles[i]); }
+
+size_t Playlist::memoryUsage() const {
+  size_t bytes = sizeof(Playlist) + entryIds.capacity() * sizeof(int64_t);
+  bytes += (dirs.capacity() + names.capacity() + titles.capacity()) * sizeof(Str);
+  if (arena != nullptr) bytes += sizeof(Arena) + arena->capacity();
+  return bytes;
+}
+}  // namespace ImPlay
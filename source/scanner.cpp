@@ -0,0 +1,224 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <strnatcmp.h>
+#include "scanner.h"
+
+namespace fs = std::filesystem;
+
+namespace ImPlay {
+struct Scanner::Job {
+  struct Dir;
+  struct Entry {
+    fs::path path;
+    std::string name;          // file name, the sort key
+    std::unique_ptr<Dir> dir;  // set for directories
+  };
+  struct Dir {
+    fs::path path;
+    std::vector<Entry> entries;  // naturally sorted by name once listed
+    bool listed = false;         // guarded by lock
+  };
+
+  static constexpr auto PUBLISH_INTERVAL = std::chrono::milliseconds(250);
+
+  void cancel();
+  void work();
+  void collect();
+  void list(Dir *dir);
+
+  Callback ready;  // guarded by lock, cleared on cancel
+  Filter filter;
+  std::unique_ptr<Dir> root;
+
+  std::vector<std::thread> threads;  // the workers and the collector, only touched by the Scanner
+  std::mutex lock;
+  std::condition_variable workCond;  // workers wait for directories to read
+  std::condition_variable listCond;  // the collector waits for the next directory in order
+  std::vector<Dir *> queue;          // directories to read, the next in sort order at the back
+  std::vector<std::string> found;    // files in order, not taken yet
+  size_t dirs = 0, files = 0;
+  bool done = false;
+  std::atomic_bool cancelled = false;  // set under lock, so a waiting thread can't miss it
+};
+
+Scanner::Scanner(const Callback &ready) : ready(ready) {}
+
+Scanner::~Scanner() { detach(); }
+
+void Scanner::start(const std::vector<fs::path> &roots, const Filter &filter) {
+  detach();
+  job = std::make_shared<Job>();
+  job->ready = ready;
+  job->filter = filter;
+  job->root = std::make_unique<Job::Dir>();
+  job->root->listed = true;
+  for (auto &path : roots) {
+    std::error_code ec;
+    if (fs::is_directory(path, ec))
+      job->root->entries.push_back({path, "", std::make_unique<Job::Dir>(Job::Dir{path})});
+    else
+      job->root->entries.push_back({path});
+  }
+  for (auto it = job->root->entries.rbegin(); it != job->root->entries.rend(); it++)
+    if (it->dir) job->queue.push_back(it->dir.get());
+
+  int threads = std::clamp((int)std::thread::hardware_concurrency(), 2, 8);
+  for (int i = 0; i < threads; i++) job->threads.emplace_back([job = job]() { job->work(); });
+  job->threads.emplace_back([job = job]() { job->collect(); });
+}
+
+void Scanner::cancel() {
+  if (job) job->cancel();
+}
+
+void Scanner::stop() {
+  if (!job) return;
+  job->cancel();
+  for (auto &thread : job->threads) thread.join();
+  job.reset();
+}
+
+// the threads keep the job alive until they are done
+void Scanner::detach() {
+  if (!job) return;
+  job->cancel();
+  for (auto &thread : job->threads) thread.detach();
+  job.reset();
+}
+
+void Scanner::take(std::vector<std::string> &out) {
+  if (!job) return;
+  std::lock_guard<std::mutex> guard(job->lock);
+  if (out.empty())
+    out.swap(job->found);
+  else
+    std::move(job->found.begin(), job->found.end(), std::back_inserter(out));
+  job->found.clear();
+}
+
+Scanner::Progress Scanner::progress() const {
+  if (!job) return {};
+  std::lock_guard<std::mutex> guard(job->lock);
+  return {job->dirs, job->files, job->done};
+}
+
+void Scanner::Job::cancel() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    cancelled = true;
+    ready = nullptr;
+  }
+  workCond.notify_all();
+  listCond.notify_all();
+}
+
+void Scanner::Job::work() {
+  for (;;) {
+    Dir *dir;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      workCond.wait(guard, [this] { return cancelled || done || !queue.empty(); });
+      if (cancelled || done) return;
+      dir = queue.back();
+      queue.pop_back();
+    }
+    list(dir);
+  }
+}
+
+// Reads one directory. Subdirectories are queued in reverse order, so idle workers pick up the one the
+// collector needs next first.
+void Scanner::Job::list(Dir *dir) {
+  std::vector<Entry> entries;
+  std::error_code ec;
+  auto it = fs::directory_iterator(dir->path, fs::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != fs::directory_iterator() && !cancelled; it.increment(ec)) {
+    std::error_code err;
+    auto &path = it->path();
+    if (it->is_directory(err) && !it->is_symlink(err))
+      entries.push_back({path, path.filename().string(), std::make_unique<Dir>(Dir{path})});
+    else if (filter(path))
+      entries.push_back({path, path.filename().string()});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return strnatcasecmp(a.name.c_str(), b.name.c_str()) < 0; });
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    dir->entries = std::move(entries);
+    dir->listed = true;
+    dirs++;
+    for (auto e = dir->entries.rbegin(); e != dir->entries.rend(); e++)
+      if (e->dir) queue.push_back(e->dir.get());
+  }
+  workCond.notify_all();
+  listCond.notify_one();
+}
+
+// Walks the tree depth-first in sort order, waiting for directories that are not read yet. The first file
+// is published right away, the following ones at most every PUBLISH_INTERVAL: each batch grows mpv's
+// playlist, which is sent back to us as a whole. ready is called under the lock, so it is never called
+// once cancel() returned.
+void Scanner::Job::collect() {
+  struct Frame {
+    Dir *dir;
+    size_t next = 0;
+  };
+  std::vector<Frame> stack{{root.get()}};
+  std::vector<std::string> batch;
+  auto published = std::chrono::steady_clock::now();
+  auto publish = [&]() {
+    published = std::chrono::steady_clock::now();
+    if (batch.empty()) return;
+    std::lock_guard<std::mutex> guard(lock);
+    files += batch.size();
+    std::move(batch.begin(), batch.end(), std::back_inserter(found));
+    batch.clear();
+    if (ready) ready();
+  };
+
+  size_t total = 0;
+  while (!stack.empty() && !cancelled) {
+    Dir *dir = stack.back().dir;
+    if (stack.back().next == 0) {
+      std::unique_lock<std::mutex> guard(lock);
+      auto listed = [&] { return dir->listed || cancelled; };
+      while (!batch.empty() && !listCond.wait_until(guard, published + PUBLISH_INTERVAL, listed)) {
+        guard.unlock();
+        publish();
+        guard.lock();
+      }
+      listCond.wait(guard, listed);
+      if (cancelled) break;
+    }
+
+    if (stack.back().next >= dir->entries.size()) {
+      dir->entries.clear();  // the whole subtree was published
+      stack.pop_back();
+      continue;
+    }
+    auto &entry = dir->entries[stack.back().next++];
+    if (entry.dir) {
+      stack.push_back({entry.dir.get()});
+    } else {
+      batch.push_back(entry.path.string());
+      if (total++ == 0 || std::chrono::steady_clock::now() - published >= PUBLISH_INTERVAL) publish();
+    }
+  }
+
+  if (!cancelled) publish();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+    if (ready) ready();
+  }
+  workCond.notify_all();
+}
+}  // namespace ImPlay
@@ -3,85 +3,177 @@
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <thread>
 #include "helpers/utils.h"
 #include "helpers/imgui.h"
+#include "helpers/media.h"
+#include "helpers/notifier.h"
+#include "scanner.h"
 #include "views/command_palette.h"
 
 namespace ImPlay::Views {
-CommandPalette::CommandPalette(Config* config, Mpv* mpv) : View(config, mpv) {
-  providers["bindings"] = [=, this](const char*) {
-    for (auto& item : mpv->bindings)
-      items.push_back({
-          item.comment,
-          item.cmd,
-          item.key,
-          -1,
-          [=, this]() { mpv->command(item.cmd); },
-      });
+CommandPalette::CommandPalette(Config* config, Mpv* mpv, const std::function<void()>& wakeup)
+    : View(config, mpv), wakeup(wakeup) {
+  providers["bindings"] = [=, this](const char*) -> Task {
     pos = 0;
+    return [=, state = mpv->state()](const Sink& sink) {
+      std::vector<CommandItem> batch;
+      for (auto& item : *state->bindings)
+        batch.push_back({
+            item.comment,
+            item.cmd,
+            item.key,
+            -1,
+            [=](const CommandItem&) { mpv->command(item.cmd); },
+        });
+      sink(std::move(batch));
+    };
   };
-  providers["chapters"] = [=, this](const char*) {
-    for (auto& item : mpv->chapters) {
-      auto title = item.title.empty() ? fmt::format("Chapter {}", item.id + 1) : item.title;
-      auto time = fmt::format("{:%H:%M:%S}", std::chrono::duration<int>((int)item.time));
-      items.push_back({
-          title,
-          "",
-          time,
-          item.id,
-          [=, this]() { mpv->commandv("seek", std::to_string(item.time).c_str(), "absolute", nullptr); },
-      });
-    }
-    pos = mpv->chapter;
+  providers["chapters"] = [=, this](const char*) -> Task {
+    auto state = mpv->state();
+    pos = state->chapter;
+    return [=](const Sink& sink) {
+      std::vector<CommandItem> batch;
+      for (auto& item : *state->chapters) {
+        auto title = item.title.empty() ? fmt::format("Chapter {}", item.id + 1) : item.title;
+        auto time = fmt::format("{:%H:%M:%S}", std::chrono::duration<int>((int)item.time));
+        batch.push_back({
+            title,
+            "",
+            time,
+            item.id,
+            [=](const CommandItem&) { mpv->commandv("seek", std::to_string(item.time).c_str(), "absolute", nullptr); },
+        });
+      }
+      sink(std::move(batch));
+    };
   };
-  providers["playlist"] = [=, this](const char*) {
-    for (auto& item : mpv->playlist) {
-      std::string title = item.title;
-      if (title.empty() && !item.filename().empty()) title = item.filename();
-      if (title.empty()) title = fmt::format("Item {}", item.id + 1);
-      items.push_back({
-          title,
-          item.path.string(),
-          "",
-          item.id,
-          [=, this]() { mpv->commandv("playlist-play-index", std::to_string(item.id).c_str(), nullptr); },
-      });
-    }
-    pos = mpv->playlistPos;
+  providers["playlist"] = [=, this](const char*) -> Task {
+    auto state = mpv->state();
+    pos = state->playlistPos;
+    return [=](const Sink& sink) {
+      std::vector<CommandItem> batch;
+      for (auto item : *state->playlist) {
+        std::string title(item.title.empty() ? item.name : item.title);
+        if (title.empty()) title = fmt::format("Item {}", item.id + 1);
+        auto id = item.id;
+        batch.push_back({
+            title,
+            item.path(),
+            "",
+            id,
+            [=](const CommandItem&) { mpv->commandv("playlist-play-index", std::to_string(id).c_str(), nullptr); },
+        });
+        if (batch.size() < BATCH_SIZE) continue;
+        if (!sink(std::move(batch))) return;
+        batch.clear();
+      }
+      sink(std::move(batch));
+    };
   };
-  providers["tracks"] = [=, this](const char* type) {
-    for (auto& item : mpv->tracks) {
-      if (type != nullptr && item.type != type) continue;
-      auto title = item.title.empty() ? fmt::format("Track {}", item.id) : item.title;
-      if (!item.lang.empty()) title += fmt::format(" [{}]", item.lang);
-      items.push_back({
-          title,
-          "",
-          toupper(item.type),
-          item.id,
-          [=, this]() {
-            if (item.type == "audio")
-              mpv->property<int64_t, MPV_FORMAT_INT64>("aid", item.id);
-            else if (item.type == "video")
-              mpv->property<int64_t, MPV_FORMAT_INT64>("vid", item.id);
-            else if (item.type == "sub")
-              mpv->property<int64_t, MPV_FORMAT_INT64>("sid", item.id);
-          },
-      });
-    }
+  providers["tracks"] = [=, this](const char* arg) -> Task {
     pos = 0;
+    return [=, state = mpv->state(), type = std::string(arg != nullptr ? arg : "")](const Sink& sink) {
+      std::vector<CommandItem> batch;
+      for (auto& item : *state->tracks) {
+        if (!type.empty() && item.type != type) continue;
+        auto title = item.title.empty() ? fmt::format("Track {}", item.id) : item.title;
+        if (!item.lang.empty()) title += fmt::format(" [{}]", item.lang);
+        batch.push_back({
+            title,
+            "",
+            toupper(item.type),
+            item.id,
+            [=](const CommandItem&) {
+              if (item.type == "audio")
+                mpv->property<int64_t, MPV_FORMAT_INT64>("aid", item.id);
+              else if (item.type == "video")
+                mpv->property<int64_t, MPV_FORMAT_INT64>("vid", item.id);
+              else if (item.type == "sub")
+                mpv->property<int64_t, MPV_FORMAT_INT64>("sid", item.id);
+            },
+        });
+      }
+      sink(std::move(batch));
+    };
   };
-  providers["history"] = [=, this](const char*) {
-    for (auto& file : config->getRecentFiles()) {
-      items.push_back({
-          file.title,
-          file.path,
-          "",
-          -1,
-          [=, this]() { mpv->commandv("loadfile", file.path.c_str(), nullptr); },
-      });
-    }
+  providers["history"] = [=, this](const char*) -> Task {
     pos = 0;
+    return [=, files = config->getRecentFiles()](const Sink& sink) {
+      std::vector<CommandItem> batch;
+      for (auto& file : files) {
+        batch.push_back({
+            file.title,
+            file.path,
+            "",
+            -1,
+            [=](const CommandItem&) { mpv->commandv("loadfile", file.path.c_str(), nullptr); },
+        });
+      }
+      sink(std::move(batch));
+    };
+  };
+  providers["files"] = [this](const char* arg) { return files(arg != nullptr && strcmp(arg, "refresh") == 0); };
+}
+
+CommandPalette::~CommandPalette() { cancel(); }
+
+// Media files of the library dirs. The first time, and with the refresh argument, the dirs are scanned and
+// the files streamed in as they are found; later the result of that scan is listed again.
+CommandPalette::Task CommandPalette::files(bool refresh) {
+  auto dirs = config->Data.Library.Dirs;
+  if (dirs.empty()) {
+    mpv->commandv("show-text", "views.command_palette.files.empty"_i18n, nullptr);
+    return nullptr;
+  }
+  std::shared_ptr<const std::vector<std::string>> cached;
+  {
+    std::lock_guard<std::mutex> guard(shared->lock);
+    if (!refresh && shared->library.dirs == dirs) cached = shared->library.files;
+  }
+  pos = -1;
+
+  return [=, mpv = mpv, shared = shared](const Sink& sink) {
+    auto open = [mpv](const CommandItem& item) { mpv->commandv("loadfile", item.tooltip.c_str(), nullptr); };
+    auto toItem = [&](const std::string& path) -> CommandItem {
+      auto sep = path.find_last_of("/\\");
+      return {sep == std::string::npos ? path : path.substr(sep + 1), path, "", -1, open};
+    };
+    std::vector<CommandItem> batch;
+    if (cached != nullptr) {
+      for (auto& path : *cached) {
+        batch.push_back(toItem(path));
+        if (batch.size() < BATCH_SIZE) continue;
+        if (!sink(std::move(batch))) return;
+        batch.clear();
+      }
+      sink(std::move(batch));
+      return;
+    }
+
+    std::vector<std::filesystem::path> roots;
+    for (auto& dir : split(dirs, ";"))
+      if (!dir.empty()) roots.emplace_back(reinterpret_cast<const char8_t*>(dir.c_str()));
+    Notifier notifier;
+    Scanner scanner([&]() { notifier.notify(); });
+    scanner.start(roots, [](const std::filesystem::path& path) { return Media::isMedia(Media::classify(path)); });
+
+    auto all = std::make_shared<std::vector<std::string>>();
+    std::vector<std::string> found;
+    for (bool done = false; !done;) {
+      notifier.wait_until(Notifier::Clock::now() + std::chrono::milliseconds(100));
+      done = scanner.progress().done;  // before taking, so nothing published after is missed
+      scanner.take(found);
+      for (auto& path : found) batch.push_back(toItem(path));
+      std::move(found.begin(), found.end(), std::back_inserter(*all));
+      found.clear();
+      if (!sink(std::move(batch))) return;
+      batch.clear();
+    }
+
+    std::lock_guard<std::mutex> guard(shared->lock);
+    shared->library = {dirs, all};
   };
 }
 
@@ -89,19 +181,81 @@ void CommandPalette::show(int n, const char** args) {
   std::string target = "bindings";
   if (n > 0) target = args[0];
   if (!providers.contains(target)) return;
-  auto callback = providers[target];
 
+  cancel();
   items.clear();
-  callback(n > 1 ? args[1] : nullptr);
+  matcher.clear();
+  matches.clear();
+  labelWidth = 0;
+  auto task = providers[target](n > 1 ? args[1] : nullptr);
+  if (!task) return;
 
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> guard(shared->lock);
+    shared->received.clear();
+    shared->finished = false;
+    id = ++shared->generation;
+  }
+  std::thread([shared = shared, wakeup = wakeup, id, task]() {
+    task([&](std::vector<CommandItem>&& batch) {
+      std::lock_guard<std::mutex> guard(shared->lock);
+      if (shared->generation != id) return false;
+      if (batch.empty()) return true;
+      std::move(batch.begin(), batch.end(), std::back_inserter(shared->received));
+      shared->updated = true;
+      wakeup();
+      return true;
+    });
+    std::lock_guard<std::mutex> guard(shared->lock);
+    if (shared->generation != id) return;
+    shared->finished = true;
+    shared->updated = true;
+    wakeup();
+  }).detach();
+  active = loading = true;
+  scrollToPos = true;
   View::show();
 }
 
+// The generation is changed under the lock, so no wakeup is sent for a cancelled task once this returns.
+void CommandPalette::cancel() {
+  {
+    std::lock_guard<std::mutex> guard(shared->lock);
+    shared->generation++;
+  }
+  loading = false;
+}
+
+void CommandPalette::update() {
+  if (!shared->updated.exchange(false)) return;
+  std::vector<CommandItem> batch;
+  {
+    std::lock_guard<std::mutex> guard(shared->lock);
+    batch.swap(shared->received);
+    if (shared->finished) loading = false;
+  }
+  if (batch.empty()) return;
+
+  items.reserve(items.size() + batch.size());
+  for (auto& item : batch) {
+    if (!item.label.empty()) labelWidth = std::max(labelWidth, ImGui::CalcTextSize(item.label.c_str()).x);
+    matcher.add(item.title, item.tooltip);
+    items.push_back(std::move(item));
+  }
+  match(buffer.data());
+}
+
 void CommandPalette::draw() {
-  if (items.empty()) return;
+  if (!active) return;
+  update();
   if (m_open) {
-    ImGui::OpenPopup("##command_palette");
     m_open = false;
+    if (!loading && items.empty()) {
+      active = false;
+      return;
+    }
+    ImGui::OpenPopup("##command_palette");
     justOpened = true;
   }
 
@@ -113,16 +267,28 @@ void CommandPalette::draw() {
   if (ImGui::BeginPopup("##command_palette")) {
     if (justOpened) {
       focusInput = true;
-      match("");
       std::memset(buffer.data(), 0x00, buffer.size());
+      match("");
       justOpened = false;
     }
+    if (!loading && items.empty()) ImGui::CloseCurrentPopup();
 
     drawInput();
     ImGui::Separator();
+    if (loading) {
+      auto count = items.size();
+      ImGui::TextDisabled("%s", i18n_a("views.command_palette.loading", count).c_str());
+    }
     drawList(popupSize.x);
 
     ImGui::EndPopup();
+  } else {
+    // closed: stop the task and free the items, there may be millions of them
+    cancel();
+    active = false;
+    items = {};
+    matcher = FuzzyMatcher();
+    matches = {};
   }
 }
 
@@ -148,85 +314,68 @@ void CommandPalette::drawInput() {
   if (ImGui::IsItemFocused() && ImGui::IsKeyReleased(ImGuiKey_UpArrow)) focusInput = true;
 }
 
+// Only the visible rows are submitted. Rows get the height of the label buttons if there are any, so they
+// are all the same height as the clipper expects.
 void CommandPalette::drawList(float width) {
   ImGui::BeginChild("##command_matches", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_NavFlattened);
-  float maxWidth = 0;
-  for (const auto& match : matches) {
-    auto width = ImGui::CalcTextSize(match.label.c_str()).x;
-    if (width > maxWidth) maxWidth = width;
-  }
-  ImGuiWindow* window = ImGui::GetCurrentWindow();
   ImGuiStyle style = ImGui::GetStyle();
-  for (const auto& match : matches) {
-    std::string title = match.title;
-    if (title.empty()) title = match.tooltip;
-    ImVec2 contentAvail = ImGui::GetContentRegionAvail();
-    float lWidth = contentAvail.x;
-    auto rWidth = maxWidth + 2 * style.ItemInnerSpacing.x + style.ItemSpacing.x;
-    if (rWidth > 0) lWidth -= rWidth;
-
-    ImGui::PushID(&match);
-    ImGui::SetNextItemWidth(lWidth);
-    if (ImGui::Selectable("", false, ImGuiSelectableFlags_DontClosePopups)) {
-      pos = match.id;
-      match.callback();
-    }
-    if (!match.tooltip.empty() && ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
-      ImGui::SetTooltip("%s", match.tooltip.c_str());
-    ImGui::SameLine();
-
-    bool selected = pos > 0 && match.id == pos;
-    auto color = ImGui::GetStyleColorVec4(selected ? ImGuiCol_CheckMark : ImGuiCol_Text);
-    ImGui::PushStyleColor(ImGuiCol_Text, color);
-    ImGui::TextEllipsis(title.c_str(), contentAvail.x - rWidth - style.ItemSpacing.x);
-    if (ImGui::IsWindowAppearing() && selected) ImGui::SetScrollHereY(0.25f);
-    ImGui::PopStyleColor();
-
-    if (!match.label.empty()) {
-      ImGui::SameLine(contentAvail.x - rWidth);
-      ImGui::BeginDisabled();
-      ImGui::Button(match.label.c_str());
-      ImGui::EndDisabled();
-    }
+  float rowHeight = labelWidth > 0 ? ImGui::GetFrameHeight() : ImGui::GetTextLineHeight();
 
-    ImGui::PopID();
+  // scroll to the current item once it has arrived
+  int selectedRow = -1;
+  if (scrollToPos && pos > 0 && !filtered) {
+    auto it = std::find_if(matches.begin(), matches.end(), [&](uint32_t i) { return items[i].id == pos; });
+    if (it != matches.end()) selectedRow = (int)(it - matches.begin());
+    scrollToPos = selectedRow < 0 && loading;
+  }
+
+  ImGuiListClipper clipper;
+  clipper.Begin((int)matches.size(), rowHeight + style.ItemSpacing.y);
+  if (selectedRow >= 0) clipper.IncludeItemByIndex(selectedRow);
+  while (clipper.Step()) {
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+      auto& match = items[matches[row]];
+      std::string title = match.title;
+      if (title.empty()) title = match.tooltip;
+      ImVec2 contentAvail = ImGui::GetContentRegionAvail();
+      float lWidth = contentAvail.x;
+      auto rWidth = labelWidth + 2 * style.ItemInnerSpacing.x + style.ItemSpacing.x;
+      if (rWidth > 0) lWidth -= rWidth;
+
+      ImGui::PushID(&match);
+      ImGui::SetNextItemWidth(lWidth);
+      if (ImGui::Selectable("", false, ImGuiSelectableFlags_DontClosePopups, ImVec2(0, rowHeight))) {
+        pos = match.id;
+        match.callback(match);
+      }
+      if (!match.tooltip.empty() && ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+        ImGui::SetTooltip("%s", match.tooltip.c_str());
+      ImGui::SameLine();
+
+      bool selected = pos > 0 && match.id == pos;
+      auto color = ImGui::GetStyleColorVec4(selected ? ImGuiCol_CheckMark : ImGuiCol_Text);
+      ImGui::PushStyleColor(ImGuiCol_Text, color);
+      ImGui::TextEllipsis(title.c_str(), contentAvail.x - rWidth - style.ItemSpacing.x);
+      if (row == selectedRow) ImGui::SetScrollHereY(0.25f);
+      ImGui::PopStyleColor();
+
+      if (!match.label.empty()) {
+        ImGui::SameLine(contentAvail.x - rWidth);
+        ImGui::BeginDisabled();
+        ImGui::Button(match.label.c_str());
+        ImGui::EndDisabled();
+      }
+
+      ImGui::PopID();
+    }
   }
   if (filtered) {
     ImGui::SetScrollY(0.0f);
     filtered = false;
+    scrollToPos = false;
   }
   ImGui::EndChild();
 }
 
-void CommandPalette::match(const std::string& input) {
-  constexpr static auto MatchCommand = [](const std::string& input, const std::string& text) -> int {
-    if (input.empty()) return 1;
-    auto l_text = tolower(text);
-    auto l_input = tolower(input);
-    if (l_text.starts_with(l_input)) return 3;
-    if (l_text.find(l_input) != std::string::npos) return 2;
-    return 0;
-  };
-
-  if (input.empty()) {
-    matches = items;
-    return;
-  }
-
-  std::vector<std::pair<CommandItem, int>> result;
-
-  for (const auto& item : items) {
-    int score = MatchCommand(input, item.title) * 2;
-    if (score == 0) score = MatchCommand(input, item.tooltip);
-    if (score > 0) result.push_back(std::make_pair(item, score));
-  }
-  std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
-    if (a.second != b.second) return a.second > b.second;
-    if (a.first.title != b.first.title) return a.first.title < b.first.title;
-    return a.first.tooltip < b.first.tooltip;
-  });
-
-  matches.clear();
-  for (const auto& [item, _] : result) matches.push_back(item);
-}
+void CommandPalette::match(const std::string& input) { matches = matcher.match(input); }
 }  // namespace ImPlay::Views
\ No newline at end of file
@@ -15,26 +15,55 @@ void ContextMenu::draw() {
 
   if (ImGui::BeginPopup("##context_menu", ImGuiWindowFlags_NoMove)) {
     if (ImGui::GetIO().AppFocusLost) ImGui::CloseCurrentPopup();
-    draw(build());
+    update();
+    draw(menu);
     ImGui::EndPopup();
   }
 }
 
-void ContextMenu::draw(std::vector<ContextMenu::Item> items) {
+void ContextMenu::update() {
+  bool stp = config->Data.Recent.SpaceToPlayLast;
+  auto state = mpv->state();
+  bool playing = state->playing();
+  Inputs current{stp, playing, (stp && !playing) || state->pause, state->playlist->size() > 1,
+                 state->chapters->size() > 1, config->Data.Mpv.WatchLater, getLang()};
+  if (!menu.empty() && current == inputs) return;
+  inputs = std::move(current);
+  menu = build();
+  translate(menu);
+}
+
+void ContextMenu::translate(std::vector<ContextMenu::Item> &items) {
+  for (auto &item : items) {
+    if (item.type == TYPE_NORMAL || item.type == TYPE_SUBMENU) item.label = i18n(item.label);
+    translate(item.submenu);
+  }
+}
+
+bool ContextMenu::Titles::stale(std::shared_ptr<const void> list) {
+  if (list == source && lang == getLang()) return false;
+  source = std::move(list);
+  lang = getLang();
+  items.clear();
+  all.clear();
+  return true;
+}
+
+void ContextMenu::draw(const std::vector<ContextMenu::Item> &items) {
   for (auto &item : items) {
     switch (item.type) {
       case TYPE_SEPARATOR:
         ImGui::Separator();
         break;
       case TYPE_NORMAL:
-        if (ImGui::MenuItemEx(i18n(item.label).c_str(), item.icon.c_str(), item.shortcut.c_str(), item.selected,
+        if (ImGui::MenuItemEx(item.label.c_str(), item.icon.c_str(), item.shortcut.c_str(), item.selected,
                               item.enabled)) {
-          if (item.cmd != "") mpv->command(item.cmd.c_str());
+          if (!item.cmd.empty()) mpv->command(item.cmd.c_str());
           if (item.callback) item.callback();
         }
         break;
       case TYPE_SUBMENU:
-        if (ImGui::BeginMenuEx(i18n(item.label).c_str(), item.icon.c_str(), item.enabled)) {
+        if (ImGui::BeginMenuEx(item.label.c_str(), item.icon.c_str(), item.enabled)) {
           draw(item.submenu);
           ImGui::EndMenu();
         }
@@ -48,10 +77,11 @@ void ContextMenu::draw(std::vector<ContextMenu::Item> items) {
 
 std::vector<ContextMenu::Item> ContextMenu::build() {
   bool stp = config->Data.Recent.SpaceToPlayLast;
-  bool playing = mpv->playing();
-  bool paused = (stp && !playing) || mpv->pause;
-  auto playlist = mpv->playlist;
-  auto chapters = mpv->chapters;
+  auto state = mpv->state();
+  bool playing = state->playing();
+  bool paused = (stp && !playing) || state->pause;
+  auto playlist = state->playlist;
+  auto chapters = state->chapters;
 #ifdef __APPLE__
 #define CTRL "Cmd"
 #else
@@ -67,6 +97,7 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
       {TYPE_SUBMENU, "", "menu.open", ICON_FA_FOLDER_OPEN, "", true, false, {
         {TYPE_NORMAL, "script-message-to implay open", "menu.open.files", ICON_FA_FILE},
         {TYPE_NORMAL, "script-message-to implay open-folder", "menu.open.folder", ICON_FA_FOLDER},
+        {TYPE_NORMAL, "script-message-to implay command-palette files", "menu.open.library", ICON_FA_SEARCH},
         {.type = TYPE_CALLBACK, .callback = [this](){ drawRecentFiles(); } },
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "script-message-to implay open-url", "menu.open.url", ICON_FA_GLOBE},
@@ -93,12 +124,12 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
           {TYPE_NORMAL, "set speed 0.5", "0.5x"},
         }},
         {TYPE_SEPARATOR},
-        {TYPE_NORMAL, "playlist-next", "menu.playback.next_media", ICON_FA_ARROW_RIGHT, ">", playlist.size() > 1},
-        {TYPE_NORMAL, "playlist-prev", "menu.playback.previous_media", ICON_FA_ARROW_LEFT, "<", playlist.size() > 1},
+        {TYPE_NORMAL, "playlist-next", "menu.playback.next_media", ICON_FA_ARROW_RIGHT, ">", playlist->size() > 1},
+        {TYPE_NORMAL, "playlist-prev", "menu.playback.previous_media", ICON_FA_ARROW_LEFT, "<", playlist->size() > 1},
         {TYPE_NORMAL, "script-message-to implay command-palette playlist", "menu.playlist"},
         {TYPE_SEPARATOR},
-        {TYPE_NORMAL, "add chapter 1", "menu.playback.next_chapter", ICON_FA_FAST_FORWARD, "PGUP", chapters.size() > 1},
-        {TYPE_NORMAL, "add chapter -1", "menu.playback.previous_chapter", ICON_FA_FAST_BACKWARD, "PGDWN", chapters.size() > 1},
+        {TYPE_NORMAL, "add chapter 1", "menu.playback.next_chapter", ICON_FA_FAST_FORWARD, "PGUP", chapters->size() > 1},
+        {TYPE_NORMAL, "add chapter -1", "menu.playback.previous_chapter", ICON_FA_FAST_BACKWARD, "PGDWN", chapters->size() > 1},
         {TYPE_NORMAL, "script-message-to implay command-palette chapters", "menu.chapters"},
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "ab-loop", "menu.playback.ab_loop", "", "l", playing},
@@ -106,7 +137,7 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
         {TYPE_NORMAL, "cycle-values loop-playlist inf no", "menu.playback.playlist_loop"},
       }},
       {TYPE_SUBMENU, "", "menu.audio", ICON_FA_VOLUME_UP, "", true, false, {
-        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("audio", "aid", mpv->aid); }},
+        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("audio", "aid", mpv->state()->aid); }},
         {.type = TYPE_CALLBACK, .callback = [this](){ drawAudioDeviceList(); }},
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "add volume 2", "menu.audio.inc_volume", ICON_FA_VOLUME_UP, "0", true},
@@ -120,7 +151,7 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
         {TYPE_NORMAL, "script-message-to implay quickview audio", "menu.quickview"},
       }},
       {TYPE_SUBMENU, "", "menu.video", ICON_FA_VIDEO, "", true, false, {
-        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("video", "vid", mpv->vid); }},
+        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("video", "vid", mpv->state()->vid); }},
         {TYPE_SUBMENU, "", "menu.video.rotate", ICON_FA_SPINNER, "", true, false, {
           {TYPE_NORMAL, "set video-rotate 90", "90°"},
           {TYPE_NORMAL, "set video-rotate 180", "180°"},
@@ -182,7 +213,7 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
         {TYPE_NORMAL, "script-message-to implay quickview video", "menu.quickview"},
       }},
       {TYPE_SUBMENU, "", "menu.subtitle", ICON_FA_FONT, "", true, false, {
-        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("sub", "sid", mpv->sid); }},
+        {.type = TYPE_CALLBACK, .callback = [this](){ drawTracklist("sub", "sid", mpv->state()->sid); }},
         {TYPE_NORMAL, "script-message-to implay load-sub", "menu.subtitle.load", ICON_FA_FOLDER_OPEN},
         {TYPE_NORMAL, "cycle sub-visibility", "menu.subtitle.show_hide", "", "v"},
         {TYPE_SEPARATOR},
@@ -200,8 +231,8 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
       {TYPE_NORMAL, "cycle fullscreen", "menu.fullscreen", ICON_FA_EXPAND, "f"},
       {TYPE_SEPARATOR},
       {TYPE_SUBMENU, "", "menu.playlist", ICON_FA_TASKS, "", true, false, {
-        {TYPE_NORMAL, "playlist-next", "menu.playlist.next", ICON_FA_ARROW_RIGHT, ">", playlist.size() > 1},
-        {TYPE_NORMAL, "playlist-prev", "menu.playlist.previous", ICON_FA_ARROW_LEFT, "<", playlist.size() > 1},
+        {TYPE_NORMAL, "playlist-next", "menu.playlist.next", ICON_FA_ARROW_RIGHT, ">", playlist->size() > 1},
+        {TYPE_NORMAL, "playlist-prev", "menu.playlist.previous", ICON_FA_ARROW_LEFT, "<", playlist->size() > 1},
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "script-message-to implay playlist-add-files", "menu.playlist.add_files", ICON_FA_PLUS},
         {TYPE_NORMAL, "script-message-to implay playlist-add-folder", "menu.playlist.add_folder", ICON_FA_FOLDER_PLUS},
@@ -211,14 +242,14 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
         {TYPE_NORMAL, "playlist-clear", "menu.playlist.clear"},
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "script-message-to implay quickview playlist", "menu.quickview"},
-        {.type = TYPE_CALLBACK, .callback = [playlist, this](){ drawPlaylist(playlist); }},
+        {.type = TYPE_CALLBACK, .callback = [this](){ drawPlaylist(); }},
       }},
       {TYPE_SUBMENU, "", "menu.chapters", ICON_FA_LIST_OL, "", true, false, {
-        {TYPE_NORMAL, "add chapter 1", "menu.chapters.next", ICON_FA_FAST_FORWARD, "", chapters.size() > 1},
-        {TYPE_NORMAL, "add chapter -1", "menu.chapters.previous", ICON_FA_FAST_BACKWARD, "", chapters.size() > 1},
+        {TYPE_NORMAL, "add chapter 1", "menu.chapters.next", ICON_FA_FAST_FORWARD, "", chapters->size() > 1},
+        {TYPE_NORMAL, "add chapter -1", "menu.chapters.previous", ICON_FA_FAST_BACKWARD, "", chapters->size() > 1},
         {TYPE_SEPARATOR},
         {TYPE_NORMAL, "script-message-to implay quickview chapters", "menu.quickview"},
-        {.type = TYPE_CALLBACK, .callback = [chapters, this](){ drawChapterlist(chapters); }},
+        {.type = TYPE_CALLBACK, .callback = [this](){ drawChapterlist(); }},
       }},
       {TYPE_NORMAL, "script-message-to implay quickview", "menu.quickview", ICON_FA_COGS},
       {TYPE_NORMAL, "script-message-to implay command-palette", "menu.command_palette", ICON_FA_SEARCH, CTRL"+Shift+p"},
@@ -250,59 +281,75 @@ std::vector<ContextMenu::Item> ContextMenu::build() {
   return items;
 }
 
-void ContextMenu::drawPlaylist(std::vector<Mpv::PlayItem> items) {
+void ContextMenu::drawPlaylist() {
+  auto state = mpv->state();
+  auto &items = *state->playlist;
   if (items.empty()) return;
 
-  auto pos = mpv->playlistPos;
-  int i = 0;
+  if (playlistTitles.stale(state->playlist)) {
+    for (size_t i = 0; i < items.size() && i < 10; i++) {
+      auto item = items[i];
+      std::string title(item.title.empty() ? item.name : item.title);
+      if (title.empty()) title = i18n_a("menu.playlist.item", item.id + 1);
+      playlistTitles.items.push_back({i, std::move(title)});
+    }
+    if (items.size() > 10) playlistTitles.all = fmt::format("{} ({})", "menu.playlist.all"_i18n, items.size());
+  }
 
   ImGui::Separator();
-  for (auto &item : items) {
-    if (i == 10) break;
-    std::string title = item.title;
-    if (title.empty() && !item.filename().empty()) title = item.filename();
-    if (title.empty()) title = i18n_a("menu.playlist.item", item.id + 1);
-    if (ImGui::MenuItemEx(title.c_str(), nullptr, nullptr, item.id == pos))
-      mpv->commandv("playlist-play-index", std::to_string(item.id).c_str(), nullptr);
-    i++;
+  for (auto &[i, title] : playlistTitles.items) {
+    auto id = items[i].id;
+    if (ImGui::MenuItemEx(title.c_str(), nullptr, nullptr, id == state->playlistPos))
+      mpv->commandv("playlist-play-index", std::to_string(id).c_str(), nullptr);
   }
-  if (items.size() > 10) {
-    if (ImGui::MenuItem(fmt::format("{} ({})", "menu.playlist.all"_i18n, items.size()).c_str()))
-      mpv->command("script-message-to implay command-palette playlist");
+  if (!playlistTitles.all.empty()) {
+    if (ImGui::MenuItem(playlistTitles.all.c_str())) mpv->command("script-message-to implay command-palette playlist");
   }
 }
 
-void ContextMenu::drawChapterlist(std::vector<Mpv::ChapterItem> items) {
+void ContextMenu::drawChapterlist() {
+  auto state = mpv->state();
+  auto &items = *state->chapters;
   if (items.empty()) return;
 
-  auto pos = mpv->chapter;
-  int i = 0;
+  if (chapterTitles.stale(state->chapters)) {
+    for (size_t i = 0; i < items.size() && i < 10; i++) {
+      auto &chapter = items[i];
+      auto title = chapter.title.empty() ? fmt::format("Chapter {}", chapter.id + 1) : chapter.title;
+      title = fmt::format("{} [{:%H:%M:%S}]", title, std::chrono::duration<int>((int)chapter.time));
+      chapterTitles.items.push_back({i, std::move(title)});
+    }
+    if (items.size() > 10) chapterTitles.all = fmt::format("{} ({})", "menu.chapters.all"_i18n, items.size());
+  }
 
   ImGui::Separator();
-  for (auto &chapter : items) {
-    if (i == 10) break;
-    auto title = chapter.title.empty() ? fmt::format("Chapter {}", chapter.id + 1) : chapter.title;
-    title = fmt::format("{} [{:%H:%M:%S}]", title, std::chrono::duration<int>((int)chapter.time));
-    if (ImGui::MenuItem(title.c_str(), nullptr, chapter.id == pos)) {
+  for (auto &[i, title] : chapterTitles.items) {
+    auto &chapter = items[i];
+    if (ImGui::MenuItem(title.c_str(), nullptr, chapter.id == state->chapter)) {
       mpv->commandv("seek", std::to_string(chapter.time).c_str(), "absolute", nullptr);
     }
-    i++;
   }
-  if (items.size() > 10) {
-    if (ImGui::MenuItem(fmt::format("{} ({})", "menu.chapters.all"_i18n, items.size()).c_str()))
-      mpv->command("script-message-to implay command-palette chapters");
+  if (!chapterTitles.all.empty()) {
+    if (ImGui::MenuItem(chapterTitles.all.c_str())) mpv->command("script-message-to implay command-palette chapters");
   }
 }
 
-void ContextMenu::drawTracklist(const char *type, const char *prop, std::string pos) {
-  std::vector<Mpv::TrackItem> tracks;
-  for (auto &track : mpv->tracks) {
-    if (track.type == type) tracks.push_back(track);
-  }
-  if (ImGui::BeginMenuEx("menu.tracks"_i18n, ICON_FA_LIST, !tracks.empty())) {
-    for (auto &track : tracks) {
+void ContextMenu::drawTracklist(const char *type, const char *prop, const std::string &pos) {
+  auto state = mpv->state();
+  auto &tracks = *state->tracks;
+  auto &titles = trackTitles[type];
+  if (titles.stale(state->tracks)) {
+    for (size_t i = 0; i < tracks.size(); i++) {
+      auto &track = tracks[i];
+      if (track.type != type) continue;
       auto title = track.title.empty() ? i18n_a("menu.tracks.item", track.id) : track.title;
       if (!track.lang.empty()) title += fmt::format(" [{}]", track.lang);
+      titles.items.push_back({i, std::move(title)});
+    }
+  }
+  if (ImGui::BeginMenuEx("menu.tracks"_i18n, ICON_FA_LIST, !titles.items.empty())) {
+    for (auto &[i, title] : titles.items) {
+      auto &track = tracks[i];
       if (ImGui::MenuItem(title.c_str(), nullptr, track.selected))
         mpv->property<int64_t, MPV_FORMAT_INT64>(prop, track.id);
     }
@@ -314,11 +361,16 @@ void ContextMenu::drawTracklist(const char *type, const char *prop, std::string
 }
 
 void ContextMenu::drawAudioDeviceList() {
-  auto devices = mpv->audioDevices;
+  auto state = mpv->state();
+  auto &devices = *state->audioDevices;
+  if (deviceTitles.stale(state->audioDevices)) {
+    for (size_t i = 0; i < devices.size(); i++)
+      deviceTitles.items.push_back({i, fmt::format("[{}] {}", devices[i].description, devices[i].name)});
+  }
   if (ImGui::BeginMenuEx("menu.audio.devices"_i18n, ICON_FA_AUDIO_DESCRIPTION, !devices.empty())) {
-    for (auto &device : devices) {
-      auto title = fmt::format("[{}] {}", device.description, device.name);
-      if (ImGui::MenuItem(title.c_str(), nullptr, device.name == mpv->audioDevice))
+    for (auto &[i, title] : deviceTitles.items) {
+      auto &device = devices[i];
+      if (ImGui::MenuItem(title.c_str(), nullptr, device.name == state->audioDevice))
         mpv->property("audio-device", device.name.c_str());
     }
     ImGui::EndMenu();
@@ -342,7 +394,8 @@ void ContextMenu::drawThemelist() {
 
 void ContextMenu::drawProfilelist() {
   if (ImGui::BeginMenuEx("menu.tools.profiles"_i18n, ICON_FA_USER_COG)) {
-    for (auto &profile : mpv->profiles) {
+    auto state = mpv->state();
+    for (auto &profile : *state->profiles) {
       if (ImGui::MenuItem(profile.c_str()))
         mpv->command(fmt::format("show-text {}; apply-profile {}", profile, profile).c_str());
     }
@@ -352,7 +405,7 @@ void ContextMenu::drawProfilelist() {
 
 void ContextMenu::drawRecentFiles() {
   if (ImGui::BeginMenuEx("menu.open.recent"_i18n, ICON_FA_HISTORY)) {
-    auto files = config->getRecentFiles();
+    auto &files = config->getRecentFiles();
     auto size = files.size();
     int i = 0;
     for (auto &file : files) {
@@ -9,7 +9,9 @@
 #include "views/debug.h"
 
 namespace ImPlay::Views {
-Debug::Debug(Config* config, Mpv* mpv) : View(config, mpv) { console = new Console(mpv); }
+Debug::Debug(Config* config, Mpv* mpv, Metrics* metrics) : View(config, mpv), metrics(metrics) {
+  console = new Console(mpv);
+}
 
 Debug::~Debug() { delete console; }
 
@@ -30,6 +32,9 @@ void Debug::draw() {
                           ImVec2(0.2f, 0.5f));
   if (ImGui::Begin("views.debug.title"_i18n, &m_open, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoScrollbar)) {
     drawHeader();
+    drawPacing();
+    drawTiming();
+    drawLatency();
     drawProperties("views.debug.options"_i18n, options);
     drawProperties("views.debug.properties"_i18n, properties);
     drawBindings();
@@ -59,6 +64,118 @@ void Debug::drawHeader() {
   ImGui::Spacing();
 }
 
+void Debug::drawPacing() {
+  auto& pacing = metrics->pacing;
+  auto& frames = metrics->frames;
+  if (m_node != "Pacing") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader("views.debug.pacing"_i18n)) return;
+  m_node = "Pacing";
+
+  double ratio = pacing.frames > 0 ? 100.0 * pacing.onTime / pacing.frames : 0;
+  uint64_t commands = mpv->commandCount();
+  if (int64_t now = mpv->time(); now - commandCountAt >= 1000000) {
+    if (commandCountAt > 0) commandRate = (commands - commandCount) * 1e6 / (now - commandCountAt);
+    commandCount = commands;
+    commandCountAt = now;
+  }
+  if (ImGui::BeginTable("##pacing", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp)) {
+    auto row = [](const char* name, std::string value) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name);
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(value.c_str());
+    };
+    row("views.debug.pacing.rendered"_i18n, fmt::format("{}", frames.rendered));
+    row("views.debug.pacing.skipped"_i18n, fmt::format("{}", frames.skipped));
+    row("views.debug.pacing.direct"_i18n, fmt::format("{}", frames.direct));
+    row("views.debug.pacing.vsync"_i18n, fmt::format("{:.3f} ms", pacing.interval / 1000.0));
+    row("views.debug.pacing.frames"_i18n, fmt::format("{}", pacing.frames));
+    row("views.debug.pacing.on_time"_i18n, fmt::format("{} ({:.1f}%)", pacing.onTime, ratio));
+    row("views.debug.pacing.missed"_i18n, fmt::format("{}", pacing.missed));
+    row("views.debug.pacing.duplicated"_i18n, fmt::format("{}", pacing.duplicated));
+    row("views.debug.pacing.commands"_i18n, fmt::format("{} ({:.1f}/s)", commands, commandRate));
+    row("views.debug.pacing.audio_reconfigs"_i18n, fmt::format("{}", metrics->audio.reconfigs));
+    double dragTime = metrics->audio.dragTime / 1e6;
+    double dragRate = dragTime > 0 ? metrics->audio.dragReconfigs / dragTime : 0;
+    row("views.debug.pacing.audio_eq_reconfigs"_i18n, fmt::format("{:.2f}/s ({:.1f}s)", dragRate, dragTime));
+    ImGui::EndTable();
+  }
+  if (ImGui::Button("views.debug.pacing.reset"_i18n)) {
+    pacing.reset();
+    frames.reset();
+    metrics->audio.reset();
+  }
+}
+
+void Debug::drawTiming() {
+  if (m_node != "Timing") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader("views.debug.timing"_i18n)) return;
+  m_node = "Timing";
+
+  auto flags = ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp;
+  if (ImGui::BeginTable("##timing", 6, flags)) {
+    ImGui::TableSetupColumn("views.debug.timing.phase"_i18n, ImGuiTableColumnFlags_WidthStretch, 2.0f);
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("max");
+    ImGui::TableSetupColumn("n");
+    ImGui::TableHeadersRow();
+    for (int i = 0; i < Metrics::PHASE_COUNT; i++) {
+      auto s = metrics->phases[i].summary();
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(Metrics::phaseName((Metrics::Phase)i));
+      for (auto v : {s.p50, s.p95, s.p99, s.max}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", v / 1000.0);
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", s.count);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::BeginDisabled();
+  ImGui::TextUnformatted("views.debug.timing.hint"_i18n);
+  ImGui::EndDisabled();
+  if (ImGui::Button("views.debug.timing.reset"_i18n))
+    for (auto& phase : metrics->phases) phase.reset();
+}
+
+void Debug::drawLatency() {
+  if (m_node != "Latency") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader("views.debug.latency"_i18n)) return;
+  m_node = "Latency";
+
+  auto flags = ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp;
+  if (ImGui::BeginTable("##latency", 6, flags)) {
+    ImGui::TableSetupColumn("views.debug.latency.command"_i18n, ImGuiTableColumnFlags_WidthStretch, 2.0f);
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("max");
+    ImGui::TableSetupColumn("n");
+    ImGui::TableHeadersRow();
+    for (auto& [name, s] : mpv->latency()) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name.c_str());
+      for (auto v : {s.p50, s.p95, s.p99, s.max}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", v / 1000.0);
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", s.count);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::BeginDisabled();
+  ImGui::TextUnformatted("views.debug.latency.hint"_i18n);
+  ImGui::EndDisabled();
+  if (ImGui::Button("views.debug.timing.reset"_i18n)) mpv->resetLatency();
+}
+
 void Debug::drawConsole() {
   ImGui::SetNextItemOpen(true, ImGuiCond_Once);
   if (m_node != "Console") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
@@ -68,7 +185,8 @@ void Debug::drawConsole() {
 }
 
 void Debug::drawBindings() {
-  auto bindings = mpv->bindings;
+  auto state = mpv->state();
+  auto &bindings = *state->bindings;
   if (m_node != "Bindings") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
   if (!ImGui::CollapsingHeader(i18n_a("views.debug.bindings", bindings.size()).c_str())) return;
   m_node = "Bindings";
@@ -510,12 +628,14 @@ void Debug::Console::ExecCommand(const char* command_line) {
     int first = History.Size - 10;
     for (int i = first > 0 ? first : 0; i < History.Size; i++) AddLog("info", "%3d: %s\n", i, History[i]);
   } else {
-    int err = mpv->command(command_line);
-    if (err < 0) {
-      AddLog("error", "%s", mpv_error_string(err));
-    } else {
-      AddLog("info", "[mpv] Success");
-    }
+    mpv->command(command_line, [this](int err, void* data) {
+      if (err < 0) {
+        AddLog("error", "%s", mpv_error_string(err));
+      } else {
+        AddLog("info", "[mpv] Success");
+      }
+      ScrollToBottom = true;
+    });
   }
 
   ScrollToBottom = true;
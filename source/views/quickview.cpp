@@ -5,7 +5,7 @@
 #include "views/quickview.h"
 
 namespace ImPlay::Views {
-Quickview::Quickview(Config *config, Mpv *mpv) : View(config, mpv) {
+Quickview::Quickview(Config *config, Mpv *mpv, Metrics *metrics) : View(config, mpv), metrics(metrics) {
   // clang-format off
   addTab("playlist", "views.quickview.playlist", [this]() { drawPlaylistTabContent(); });
   addTab("chapters", "views.quickview.chapters", [this]() { drawChaptersTabContent(); });
@@ -14,9 +14,15 @@ Quickview::Quickview(Config *config, Mpv *mpv) : View(config, mpv) {
   addTab("subtitle", "views.quickview.subtitle", [this]() { drawSubtitleTabContent(); });
   // clang-format on
 
-  mpv->observeEvent(MPV_EVENT_FILE_LOADED, [this](void *data) {
-    updateAudioEqChannels();
-    applyAudioEq(false);
+  // the audio chain was recreated from the filter string, e.g. for a new file or track
+  mpv->observeEvent(MPV_EVENT_AUDIO_RECONFIG, [this](void *data) {
+    this->metrics->audio.reconfigs++;
+    if (audioEqDragStart > 0) this->metrics->audio.dragReconfigs++;
+    this->mpv->propertyAsync("audio-params", MPV_FORMAT_NODE, [this](int error, void *data) {
+      if (error >= 0) updateAudioEqChannels(*(mpv_node *)data);
+      std::copy(std::begin(audioEqBaked), std::end(audioEqBaked), audioEqLive);
+      applyAudioEq(false);
+    });
   });
 }
 
@@ -131,8 +137,9 @@ void Quickview::drawTracks(const char *title, const char *type, const char *prop
   ImGui::TextUnformatted(title);
   alignRight(ICON_FA_TOGGLE_ON);
   bool toggle = !iequals(pos, "no");
-  if (strcmp(prop, "sid") == 0) toggle = mpv->sidv;
-  if (strcmp(prop, "secondary-sid") == 0) toggle = mpv->sidv2;
+  auto state = mpv->state();
+  if (strcmp(prop, "sid") == 0) toggle = state->sidv;
+  if (strcmp(prop, "secondary-sid") == 0) toggle = state->sidv2;
   if (toggleButton(toggle, "views.quickview.tracks.toggle"_i18n, prop)) {
     if (strstr(prop, "sid") != nullptr) {
       const char *prefix = strstr(prop, "secondary") != nullptr ? "secondary-" : "";
@@ -144,12 +151,11 @@ void Quickview::drawTracks(const char *title, const char *type, const char *prop
   if (ImGui::BeginChild(fmt::format("##tracks-{}", prop).c_str(),
                         ImVec2(-FLT_MIN, 3 * ImGui::GetFrameHeightWithSpacing()),
                         ImGuiChildFlags_FrameStyle | ImGuiChildFlags_ResizeY)) {
-    auto items = mpv->tracks;
-    if (items.empty())
-      emptyLabel();
-    else
-      items.insert(items.begin(), {0, type, "views.quickview.tracks.no"_i18n, "", false});
-    for (auto &item : items) {
+    auto &items = *state->tracks;
+    Mpv::TrackItem none{0, type, "views.quickview.tracks.no"_i18n, "", false};
+    if (items.empty()) emptyLabel();
+    for (int i = items.empty() ? 0 : -1; i < (int)items.size(); i++) {
+      auto &item = i < 0 ? none : items[i];
       if (item.type != type) continue;
       bool selected = item.id == 0 ? pos == "no" : pos == std::to_string(item.id);
       auto title = item.title.empty() ? i18n_a("views.quickview.tracks.item", item.id) : item.title;
@@ -168,13 +174,39 @@ void Quickview::drawTracks(const char *type, const char *prop, std::string pos)
   drawTracks("views.quickview.tracks"_i18n, type, prop, pos);
 }
 
+void Quickview::Rows::clear() {
+  text.clear();
+  offsets.clear();
+}
+
+void Quickview::Rows::add(std::string_view str) {
+  offsets.push_back((uint32_t)text.size());
+  text.append(str).push_back('\0');
+}
+
+// Only the visible rows are drawn, their titles are taken from playlistTitles, rebuilt per playlist and language.
 void Quickview::drawPlaylistTabContent() {
   auto style = ImGui::GetStyle();
-  auto pos = mpv->playlistPos;
+  auto state = mpv->state();
+  auto pos = state->playlistPos;
+  auto &items = *state->playlist;
+  if (playlistSource != state->playlist || playlistLang != getLang()) {
+    playlistSource = state->playlist;
+    playlistLang = getLang();
+    playlistTitles.clear();
+    playlistTitles.offsets.reserve(items.size());
+    for (auto item : items) {
+      if (!item.title.empty() || !item.name.empty()) {
+        playlistTitles.add(item.title.empty() ? item.name : item.title);
+      } else {
+        auto n = item.id + 1;
+        playlistTitles.add(i18n_a("views.quickview.playlist.item", n));
+      }
+    }
+  }
   if (ImGui::BeginListBox("##playlist", ImVec2(-FLT_MIN, -ImGui::GetFrameHeightWithSpacing()))) {
-    auto items = mpv->playlist;
     static int selected = pos;
-    auto drawContextmenu = [&](Mpv::PlayItem *item) {
+    auto drawContextmenu = [&](const Playlist::Item *item) {
       if (ImGui::MenuItem("views.quickview.playlist.menu.play"_i18n))
         mpv->commandv("playlist-play-index", std::to_string(item->id).c_str(), nullptr);
       if (ImGui::MenuItem("views.quickview.playlist.menu.play_next"_i18n))
@@ -193,31 +225,36 @@ void Quickview::drawPlaylistTabContent() {
         mpv->commandv("playlist-remove", std::to_string(item->id).c_str(), nullptr);
       ImGui::Separator();
       if (ImGui::MenuItem("views.quickview.playlist.menu.copy_path"_i18n))
-        ImGui::SetClipboardText(item->path.string().c_str());
-      if (ImGui::MenuItem("views.quickview.playlist.menu.reveal"_i18n)) revealInFolder(item->path.string());
+        ImGui::SetClipboardText(item->path().c_str());
+      if (ImGui::MenuItem("views.quickview.playlist.menu.reveal"_i18n)) revealInFolder(item->path());
     };
 
     if (items.empty()) emptyLabel();
-    for (auto &item : items) {
-      std::string title = item.title;
-      if (title.empty() && !item.filename().empty()) title = item.filename();
-      if (title.empty()) title = i18n_a("views.quickview.playlist.item", item.id + 1);
-      ImGui::PushID(item.id);
-      if (ImGui::Selectable("", selected == item.id)) selected = item.id;
-      if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
-        mpv->commandv("playlist-play-index", std::to_string(item.id).c_str(), nullptr);
-      if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) ImGui::SetTooltip("%s", title.c_str());
-      if (ImGui::BeginPopupContextItem()) {
-        drawContextmenu(&item);
-        ImGui::EndPopup();
+    bool appearing = ImGui::IsWindowAppearing();
+    ImGuiListClipper clipper;
+    clipper.Begin((int)items.size());
+    if (appearing && pos >= 0 && pos < (int64_t)items.size()) clipper.IncludeItemByIndex((int)pos);
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        auto item = items[i];
+        auto title = playlistTitles[i];
+        ImGui::PushID(i);
+        if (ImGui::Selectable("", selected == item.id)) selected = item.id;
+        if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+          mpv->commandv("playlist-play-index", std::to_string(item.id).c_str(), nullptr);
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) ImGui::SetTooltip("%s", title);
+        if (ImGui::BeginPopupContextItem()) {
+          drawContextmenu(&item);
+          ImGui::EndPopup();
+        }
+        ImGui::SameLine();
+        ImGui::PushStyleColor(ImGuiCol_Text,
+                              ImGui::GetStyleColorVec4(item.id == pos ? ImGuiCol_CheckMark : ImGuiCol_Text));
+        ImGui::TextEllipsis(title);
+        if (appearing && item.id == pos) ImGui::SetScrollHereY(0.25f);
+        ImGui::PopStyleColor();
+        ImGui::PopID();
       }
-      ImGui::SameLine();
-      ImGui::PushStyleColor(ImGuiCol_Text,
-                            ImGui::GetStyleColorVec4(item.id == pos ? ImGuiCol_CheckMark : ImGuiCol_Text));
-      ImGui::TextEllipsis(title.c_str());
-      if (ImGui::IsWindowAppearing() && item.id == pos) ImGui::SetScrollHereY(0.25f);
-      ImGui::PopStyleColor();
-      ImGui::PopID();
     }
     ImGui::EndListBox();
   }
@@ -241,30 +278,46 @@ void Quickview::drawPlaylistTabContent() {
 }
 
 void Quickview::drawChaptersTabContent() {
-  auto items = mpv->chapters;
-  auto pos = mpv->chapter;
+  auto state = mpv->state();
+  auto &items = *state->chapters;
+  auto pos = state->chapter;
+  if (chapterSource != state->chapters) {
+    chapterSource = state->chapters;
+    chapterTitles.clear();
+    chapterTimes.clear();
+    for (auto &item : items) {
+      chapterTitles.add(item.title.empty() ? fmt::format("Chapter {}", item.id + 1) : item.title);
+      chapterTimes.add(fmt::format("{:%H:%M:%S}", std::chrono::duration<int>((int)item.time)));
+    }
+  }
   if (ImGui::BeginListBox("##chapters", ImVec2(-FLT_MIN, -FLT_MIN))) {
     if (items.empty()) emptyLabel();
-    for (auto &item : items) {
-      auto title = item.title.empty() ? fmt::format("Chapter {}", item.id + 1) : item.title;
-      auto time = fmt::format("{:%H:%M:%S}", std::chrono::duration<int>((int)item.time));
-      auto color = ImGui::GetStyleColorVec4(item.id == pos ? ImGuiCol_CheckMark : ImGuiCol_Text);
-      ImGui::PushID(item.id);
-      if (ImGui::Selectable("", item.id == pos))
-        mpv->commandv("seek", std::to_string(item.time).c_str(), "absolute", nullptr);
-      ImGui::SameLine();
-      ImGui::TextColored(color, "%s", title.c_str());
-      alignRight(time.c_str());
-      ImGui::TextColored(color, "%s", time.c_str());
-      if (ImGui::IsWindowAppearing() && item.id == pos) ImGui::SetScrollHereY(0.25f);
-      ImGui::PopID();
+    bool appearing = ImGui::IsWindowAppearing();
+    ImGuiListClipper clipper;
+    clipper.Begin((int)items.size());
+    if (appearing && pos >= 0 && pos < (int64_t)items.size()) clipper.IncludeItemByIndex((int)pos);
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        auto &item = items[i];
+        auto color = ImGui::GetStyleColorVec4(item.id == pos ? ImGuiCol_CheckMark : ImGuiCol_Text);
+        ImGui::PushID(item.id);
+        if (ImGui::Selectable("", item.id == pos))
+          mpv->commandv("seek", std::to_string(item.time).c_str(), "absolute", nullptr);
+        ImGui::SameLine();
+        ImGui::TextColored(color, "%s", chapterTitles[i]);
+        alignRight(chapterTimes[i]);
+        ImGui::TextColored(color, "%s", chapterTimes[i]);
+        if (appearing && item.id == pos) ImGui::SetScrollHereY(0.25f);
+        ImGui::PopID();
+      }
     }
     ImGui::EndListBox();
   }
 }
 
 void Quickview::drawVideoTabContent() {
-  drawTracks("video", "vid", mpv->vid);
+  auto state = mpv->state();
+  drawTracks("video", "vid", state->vid);
   ImGui::NewLine();
 
   ImGui::TextUnformatted("views.quickview.video.quality"_i18n);
@@ -274,8 +327,8 @@ void Quickview::drawVideoTabContent() {
   for (auto quality : qualities) {
     if (ImGui::Button(fmt::format("{}p", quality).c_str())) {
       mpv->property("ytdl-format", fmt::format("bv*[height<={}]+ba/b[height<={}]", quality, quality).c_str());
-      if (mpv->playing()) {
-        mpv->property("start", fmt::format("+{}", mpv->timePos).c_str());
+      if (state->playing()) {
+        mpv->property("start", fmt::format("+{}", state->timePos).c_str());
         mpv->command("playlist-play-index current");
       }
     }
@@ -357,7 +410,7 @@ void Quickview::drawVideoTabContent() {
       "views.quickview.video.equalizer.hue",
   };
   int equalizer[IM_ARRAYSIZE(eq)] = {
-      (int)mpv->brightness, (int)mpv->contrast, (int)mpv->saturation, (int)mpv->gamma, (int)mpv->hue,
+      (int)state->brightness, (int)state->contrast, (int)state->saturation, (int)state->gamma, (int)state->hue,
   };
   ImGui::SetCursorPosX(ImGui::GetCursorPosX() + scaled(1));
   ImGui::BeginGroup();
@@ -365,27 +418,30 @@ void Quickview::drawVideoTabContent() {
     if (ImGui::Button(fmt::format("{}##{}", ICON_FA_UNDO, eq[i]).c_str())) mpv->commandv("set", eq[i], "0", nullptr);
     ImGui::SameLine();
     if (ImGui::SliderInt(i18n(eq_labels[i]).c_str(), &equalizer[i], -100, 100))
-      mpv->commandv("set", eq[i], std::to_string(equalizer[i]).c_str(), nullptr);
+      mpv->propertyDeferred(eq[i], std::to_string(equalizer[i]));
+    if (ImGui::IsItemDeactivated()) mpv->flushDeferred(eq[i]);
   }
   ImGui::EndGroup();
 }
 
 void Quickview::drawAudioTabContent() {
-  drawTracks("audio", "aid", mpv->aid);
+  auto state = mpv->state();
+  drawTracks("audio", "aid", state->aid);
   ImGui::NewLine();
 
   ImGui::TextUnformatted("views.quickview.audio.volume"_i18n);
-  int volume = (int)mpv->volume;
-  if (ImGui::SliderInt("##Volume", &volume, 0, 200, "%d%%"))
-    mpv->commandv("set", "volume", std::to_string(volume).c_str(), nullptr);
+  int volume = (int)state->volume;
+  if (ImGui::SliderInt("##Volume", &volume, 0, 200, "%d%%")) mpv->propertyDeferred("volume", std::to_string(volume));
+  if (ImGui::IsItemDeactivated()) mpv->flushDeferred("volume");
   ImGui::SameLine();
-  if (toggleButton(ICON_FA_VOLUME_MUTE, mpv->mute, "views.quickview.audio.mute"_i18n)) mpv->command("cycle mute");
+  if (toggleButton(ICON_FA_VOLUME_MUTE, state->mute, "views.quickview.audio.mute"_i18n)) mpv->command("cycle mute");
   ImGui::NewLine();
 
   ImGui::TextUnformatted("views.quickview.audio.delay"_i18n);
-  float delay = (float)mpv->audioDelay;
+  float delay = (float)state->audioDelay;
   if (ImGui::SliderFloat("##Delay", &delay, -10, 10, "%.1fs"))
-    mpv->commandv("set", "audio-delay", fmt::format("{:.1f}", delay).c_str(), nullptr);
+    mpv->propertyDeferred("audio-delay", fmt::format("{:.1f}", delay));
+  if (ImGui::IsItemDeactivated()) mpv->flushDeferred("audio-delay");
   iconButton(ICON_FA_UNDO, "set audio-delay 0", "views.quickview.audio.delay.reset"_i18n);
   ImGui::NewLine();
   ImGui::Separator();
@@ -395,7 +451,8 @@ void Quickview::drawAudioTabContent() {
 }
 
 void Quickview::drawSubtitleTabContent() {
-  drawTracks("sub", "sid", mpv->sid);
+  auto state = mpv->state();
+  drawTracks("sub", "sid", state->sid);
 
   iconButton(ICON_FA_ARROW_UP, "add sub-pos -1", "views.quickview.subtitle.move_up"_i18n, false);
   iconButton(ICON_FA_ARROW_DOWN, "add sub-pos 1", "views.quickview.subtitle.move_down"_i18n);
@@ -405,20 +462,22 @@ void Quickview::drawSubtitleTabContent() {
   ImGui::Separator();
   ImGui::NewLine();
 
-  drawTracks("views.quickview.subtitle.secondary"_i18n, "sub", "secondary-sid", mpv->sid2);
+  drawTracks("views.quickview.subtitle.secondary"_i18n, "sub", "secondary-sid", state->sid2);
   ImGui::NewLine();
 
   ImGui::TextUnformatted("views.quickview.subtitle.scale"_i18n);
-  float scale = (float)mpv->subScale;
+  float scale = (float)state->subScale;
   if (ImGui::SliderFloat("##Scale", &scale, 0, 4, "%.1f"))
-    mpv->commandv("set", "sub-scale", fmt::format("{:.1f}", scale).c_str(), nullptr);
+    mpv->propertyDeferred("sub-scale", fmt::format("{:.1f}", scale));
+  if (ImGui::IsItemDeactivated()) mpv->flushDeferred("sub-scale");
   iconButton(ICON_FA_UNDO, "set sub-scale 1", "views.quickview.subtitle.scale.reset"_i18n);
   ImGui::NewLine();
 
   ImGui::TextUnformatted("views.quickview.subtitle.delay"_i18n);
-  float delay = (float)mpv->subDelay;
+  float delay = (float)state->subDelay;
   if (ImGui::SliderFloat("##Delay", &delay, -10, 10, "%.1fs"))
-    mpv->commandv("set", "sub-delay", fmt::format("{:.1f}", delay).c_str(), nullptr);
+    mpv->propertyDeferred("sub-delay", fmt::format("{:.1f}", delay));
+  if (ImGui::IsItemDeactivated()) mpv->flushDeferred("sub-delay");
   iconButton(ICON_FA_UNDO, "set sub-delay 0", "views.quickview.subtitle.delay.reset"_i18n);
 }
 
@@ -458,12 +517,20 @@ void Quickview::drawAudioEq() {
   float spacing = scaled(2);
   ImVec2 size = ImVec2(scaled(0.8f), scaled(10));
   float start = ImGui::GetCursorPosX();
+  bool dragging = false;
   for (int i = 0; i < FREQ_COUNT; i++) {
     std::string label = fmt::format("##{}", audioEqFreqs[i]);
     if (ImGui::VSliderFloat(label.c_str(), size, &gain[i], -12, 12, "")) setAudioEqValue(i, gain[i]);
     if (ImGui::IsItemHovered()) ImGui::SetTooltip("%.1fdB", gain[i]);
+    dragging |= ImGui::IsItemActive();
     if (i < FREQ_COUNT - 1) ImGui::SameLine(0, spacing);
   }
+  if (dragging && audioEqDragStart == 0) {
+    audioEqDragStart = mpv->time();
+  } else if (!dragging && audioEqDragStart > 0) {
+    metrics->audio.dragTime += mpv->time() - audioEqDragStart;
+    audioEqDragStart = 0;
+  }
   for (int i = 0; i < FREQ_COUNT; i++) {
     auto tsize = ImGui::CalcTextSize(audioEqFreqs[i]);
     ImGui::SetCursorPosX(start + i * (spacing + size.x) + (size.x - tsize.x) / 2);
@@ -474,13 +541,29 @@ void Quickview::drawAudioEq() {
   if (!audioEqEnabled) ImGui::EndDisabled();
 }
 
+// Inserting the filter reinitializes the whole audio chain, so it is only done when the equalizer is enabled
+// or the channel count changed. Gain changes are sent to the running filter, per changed band and channel.
 void Quickview::applyAudioEq(bool osd) {
   std::string message = "views.quickview.audio.equalizer.msg.disabled"_i18n;
-  mpv->command("no-osd af remove @aeq");
-  if (audioEqEnabled) {
-    if (audioEqIndex < 0) return;
-    auto equalizer = audioEqPresets[audioEqIndex];
-    mpv->commandv("af", "add", equalizer.toFilter("@aeq", audioEqChannels).c_str(), nullptr);
+  if (!audioEqEnabled || audioEqIndex < 0) {
+    if (audioEqBuilt > 0) mpv->command("no-osd af remove @aeq");
+    audioEqBuilt = 0;
+    if (audioEqEnabled) return;
+  } else {
+    auto &equalizer = audioEqPresets[audioEqIndex];
+    if (audioEqBuilt != audioEqChannels) {
+      if (audioEqBuilt > 0) mpv->command("no-osd af remove @aeq");
+      mpv->commandv("af", "add", equalizer.toFilter("@aeq", audioEqChannels).c_str(), nullptr);
+      audioEqBuilt = audioEqChannels;
+      std::copy(std::begin(equalizer.values), std::end(equalizer.values), audioEqBaked);
+      std::copy(std::begin(equalizer.values), std::end(equalizer.values), audioEqLive);
+    }
+    for (int f = 0; f < FREQ_COUNT; f++) {
+      if (equalizer.values[f] == audioEqLive[f]) continue;
+      for (int ch = 0; ch < audioEqBuilt; ch++)
+        mpv->commandv("af-command", "aeq", "change", equalizer.toCommand(f, ch).c_str(), nullptr);
+      audioEqLive[f] = equalizer.values[f];
+    }
     message = i18n_a("views.quickview.audio.equalizer.msg", i18n(equalizer.name));
   }
   if (osd) mpv->commandv("show-text", message.c_str(), nullptr);
@@ -504,8 +587,7 @@ void Quickview::setAudioEqValue(int freqIndex, float gain) {
   applyAudioEq();
 }
 
-void Quickview::updateAudioEqChannels() {
-  auto node = mpv->property<mpv_node, MPV_FORMAT_NODE>("audio-params");
+void Quickview::updateAudioEqChannels(mpv_node &node) {
   if (node.format == MPV_FORMAT_NODE_MAP) {
     for (int i = 0; i < node.u.list->num; i++) {
       if (strcmp(node.u.list->keys[i], "channel-count") == 0) {
@@ -514,13 +596,13 @@ void Quickview::updateAudioEqChannels() {
       }
     }
   }
-  mpv_free_node_contents(&node);
 }
 
+// anequalizer numbers its bands in the order they are given: channel by channel, FREQ_COUNT bands each
 std::string Quickview::AudioEqItem::toFilter(const char *name, int channels) {
   std::string s;
-  double freq = 31.25;
   for (int ch = 0; ch < channels; ch++) {
+    double freq = 31.25;
     for (int f = 0; f < FREQ_COUNT; f++) {
       double v = (double)values[f] / 12;
       s += fmt::format("c{} f={} w={} g={}|", ch, freq, 1000, v);
@@ -529,4 +611,9 @@ std::string Quickview::AudioEqItem::toFilter(const char *name, int channels) {
   }
   return fmt::format("{}:lavfi=[anequalizer={}]", name, s);
 }
+
+std::string Quickview::AudioEqItem::toCommand(int band, int channel) {
+  double freq = 31.25 * (1 << band);
+  return fmt::format("f{}|f={}|w={}|g={}", channel * FREQ_COUNT + band, freq, 1000, (double)values[band] / 12);
+}
 }  // namespace ImPlay::Views
\ No newline at end of file
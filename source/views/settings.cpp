@@ -112,6 +112,14 @@ void Settings::drawGeneralTab() {
         if (data.Recent.Limit == 0) config->clearRecentFiles();
       });
     }
+    ImGui::Spacing();
+    static char libraryDirs[1024] = {0};
+    strncpy(libraryDirs, data.Library.Dirs.c_str(), IM_ARRAYSIZE(libraryDirs) - 1);
+    ImGui::TextUnformatted("views.settings.general.library.dirs"_i18n);
+    ImGui::SameLine();
+    ImGui::HelpMarker("views.settings.general.library.dirs.help"_i18n);
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::InputText("##library_dirs", libraryDirs, IM_ARRAYSIZE(libraryDirs))) data.Library.Dirs = libraryDirs;
     ImGui::Unindent();
     ImGui::TextUnformatted("views.settings.general.debug"_i18n);
     ImGui::SameLine();
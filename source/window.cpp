@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <stdexcept>
 #include <chrono>
 #include <thread>
@@ -17,10 +19,90 @@
 #include "window.h"
 
 namespace ImPlay {
+// clang-format off
+static constexpr std::pair<int, const char *> keyMappings[] = {
+    {GLFW_KEY_SPACE, "SPACE"}, {GLFW_KEY_APOSTROPHE, "'"},
+    {GLFW_KEY_COMMA, ","}, {GLFW_KEY_MINUS, "-"},
+    {GLFW_KEY_PERIOD, "."}, {GLFW_KEY_SLASH, "/"},
+
+    {GLFW_KEY_0, "0"}, {GLFW_KEY_1, "1"}, {GLFW_KEY_2, "2"},
+    {GLFW_KEY_3, "3"}, {GLFW_KEY_4, "4"}, {GLFW_KEY_5, "5"},
+    {GLFW_KEY_6, "6"}, {GLFW_KEY_7, "7"}, {GLFW_KEY_8, "8"},
+    {GLFW_KEY_9, "9"},
+
+    {GLFW_KEY_SEMICOLON, ";"}, {GLFW_KEY_EQUAL, "="},
+
+    {GLFW_KEY_A, "a"}, {GLFW_KEY_B, "b"}, {GLFW_KEY_C, "c"},
+    {GLFW_KEY_D, "d"}, {GLFW_KEY_E, "e"}, {GLFW_KEY_F, "f"},
+    {GLFW_KEY_G, "g"}, {GLFW_KEY_H, "h"}, {GLFW_KEY_I, "i"},
+    {GLFW_KEY_J, "j"}, {GLFW_KEY_K, "k"}, {GLFW_KEY_L, "l"},
+    {GLFW_KEY_M, "m"}, {GLFW_KEY_N, "n"}, {GLFW_KEY_O, "o"},
+    {GLFW_KEY_P, "p"}, {GLFW_KEY_Q, "q"}, {GLFW_KEY_R, "r"},
+    {GLFW_KEY_S, "s"}, {GLFW_KEY_T, "t"}, {GLFW_KEY_U, "u"},
+    {GLFW_KEY_V, "v"}, {GLFW_KEY_W, "w"}, {GLFW_KEY_X, "x"},
+    {GLFW_KEY_Y, "y"}, {GLFW_KEY_Z, "z"},
+
+    {GLFW_KEY_LEFT_BRACKET, "["}, {GLFW_KEY_BACKSLASH, "\\"},
+    {GLFW_KEY_RIGHT_BRACKET, "]"}, {GLFW_KEY_GRAVE_ACCENT, "`"},
+    {GLFW_KEY_ESCAPE, "ESC"}, {GLFW_KEY_ENTER, "ENTER"},
+    {GLFW_KEY_TAB, "TAB"}, {GLFW_KEY_BACKSPACE, "BS"},
+    {GLFW_KEY_INSERT, "INS"}, {GLFW_KEY_DELETE, "DEL"},
+    {GLFW_KEY_RIGHT, "RIGHT"}, {GLFW_KEY_LEFT, "LEFT"},
+    {GLFW_KEY_DOWN, "DOWN"}, {GLFW_KEY_UP, "UP"},
+    {GLFW_KEY_PAGE_UP, "PGUP"}, {GLFW_KEY_PAGE_DOWN, "PGDWN"},
+    {GLFW_KEY_HOME, "HOME"}, {GLFW_KEY_END, "END"},
+    {GLFW_KEY_PRINT_SCREEN, "PRINT"}, {GLFW_KEY_PAUSE, "PAUSE"},
+
+    {GLFW_KEY_F1, "F1"}, {GLFW_KEY_F2, "F2"}, {GLFW_KEY_F3, "F3"},
+    {GLFW_KEY_F4, "F4"}, {GLFW_KEY_F5, "F5"}, {GLFW_KEY_F6, "F6"},
+    {GLFW_KEY_F7, "F7"}, {GLFW_KEY_F8, "F8"}, {GLFW_KEY_F9, "F9"},
+    {GLFW_KEY_F10, "F10"}, {GLFW_KEY_F11, "F11"}, {GLFW_KEY_F12, "F12"},
+    {GLFW_KEY_F13, "F13"}, {GLFW_KEY_F14, "F14"}, {GLFW_KEY_F15, "F15"},
+    {GLFW_KEY_F16, "F16"}, {GLFW_KEY_F17, "F17"}, {GLFW_KEY_F18, "F18"},
+    {GLFW_KEY_F19, "F19"}, {GLFW_KEY_F20, "F20"}, {GLFW_KEY_F21, "F21"},
+    {GLFW_KEY_F22, "F22"}, {GLFW_KEY_F23, "F23"}, {GLFW_KEY_F24, "F24"},
+
+    {GLFW_KEY_KP_0, "KP0"}, {GLFW_KEY_KP_1, "KP1"}, {GLFW_KEY_KP_2, "KP2"},
+    {GLFW_KEY_KP_3, "KP3"}, {GLFW_KEY_KP_4, "KP4"}, {GLFW_KEY_KP_5, "KP5"},
+    {GLFW_KEY_KP_6, "KP6"}, {GLFW_KEY_KP_7, "KP7"}, {GLFW_KEY_KP_8, "KP8"},
+    {GLFW_KEY_KP_9, "KP9"}, {GLFW_KEY_KP_ENTER, "KP_ENTER"},
+};
+
+static constexpr std::pair<int, const char *> shiftMappings[] = {
+    {GLFW_KEY_0, ")"}, {GLFW_KEY_1, "!"}, {GLFW_KEY_2, "@"},
+    {GLFW_KEY_3, "#"}, {GLFW_KEY_4, "$"}, {GLFW_KEY_5, "%"},
+    {GLFW_KEY_6, "^"}, {GLFW_KEY_7, "&"}, {GLFW_KEY_8, "*"},
+    {GLFW_KEY_9, "("}, {GLFW_KEY_MINUS, "_"}, {GLFW_KEY_EQUAL, "+"},
+    {GLFW_KEY_LEFT_BRACKET, "{"}, {GLFW_KEY_RIGHT_BRACKET, "}"},
+    {GLFW_KEY_BACKSLASH, "|"}, {GLFW_KEY_SEMICOLON, ":"},
+    {GLFW_KEY_APOSTROPHE, "\""}, {GLFW_KEY_COMMA, "<"},
+    {GLFW_KEY_PERIOD, ">"}, {GLFW_KEY_SLASH, "?"},
+};
+
+static constexpr std::pair<int, const char *> mbtnMappings[] = {
+    {GLFW_MOUSE_BUTTON_LEFT, "MBTN_LEFT"}, {GLFW_MOUSE_BUTTON_MIDDLE, "MBTN_MID"},
+    {GLFW_MOUSE_BUTTON_RIGHT, "MBTN_RIGHT"}, {GLFW_MOUSE_BUTTON_4, "MP_MBTN_BACK"},
+    {GLFW_MOUSE_BUTTON_5, "MP_MBTN_FORWARD"},
+};
+// clang-format on
+
+// name lookup tables indexed by GLFW key or button code, built at compile time
+template <size_t size, size_t n>
+static constexpr std::array<const char *, size> keyTable(const std::pair<int, const char *> (&mappings)[n]) {
+  std::array<const char *, size> table{};
+  for (auto &[key, name] : mappings) table[key] = name;
+  return table;
+}
+static constexpr auto keyNames = keyTable<GLFW_KEY_LAST + 1>(keyMappings);
+static constexpr auto shiftNames = keyTable<GLFW_KEY_LAST + 1>(shiftMappings);
+static constexpr auto mbtnNames = keyTable<GLFW_MOUSE_BUTTON_LAST + 1>(mbtnMappings);
+
 Window::Window(Config* config) : Player(config) {
   initGLFW();
   window = glfwCreateWindow(1280, 720, PLAYER_NAME, nullptr, nullptr);
   if (window == nullptr) throw std::runtime_error("Failed to create window!");
+  videoWindow = glfwCreateWindow(1, 1, "", nullptr, window);  // hidden, only used for its shared context
+  if (videoWindow == nullptr) throw std::runtime_error("Failed to create video context!");
 #ifdef _WIN32
   hwnd = glfwGetWin32Window(window);
   if (SUCCEEDED(OleInitialize(nullptr))) oleOk = true;
@@ -39,6 +121,7 @@ Window::~Window() {
   if (oleOk) OleUninitialize();
 #endif
 
+  glfwDestroyWindow(videoWindow);
   glfwDestroyWindow(window);
   glfwTerminate();
 }
@@ -72,7 +155,6 @@ void Window::initGLFW() {
 
 bool Window::init(OptionParser& parser) {
   mpv->wakeupCb() = [this](Mpv* ctx) { wakeup(); };
-  mpv->updateCb() = [this](Mpv* ctx) { videoWaiter.notify(); };
   if (!Player::init(parser.options)) return false;
 
   for (auto& path : parser.paths) {
@@ -107,62 +189,94 @@ bool Window::init(OptionParser& parser) {
 }
 
 void Window::run() {
-  bool shutdown = false;
-  std::thread videoRenderer([&]() {
-    while (!shutdown) {
-      videoWaiter.wait();
-      if (shutdown) break;
-
-      if (mpv->wantRender()) {
-        renderVideo();
-        wakeup();
-      }
-    }
-  });
-
+  startVideo();
   restoreState();
   glfwShowWindow(window);
 
-  double lastTime = glfwGetTime();
+  // sleep until there is work: input, mpv wakeups, a new video frame or an animation deadline
   while (!glfwWindowShouldClose(window)) {
-    if (!glfwGetWindowAttrib(window, GLFW_VISIBLE) || glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+    double timeout = waitTimeout();
+    if (timeout < 0)
       glfwWaitEvents();
-    else
+    else if (timeout > 0)
+      glfwWaitEventsTimeout(timeout);
+    else {
+      Metrics::Probe probe(&metrics, Metrics::PHASE_EVENTS);
       glfwPollEvents();
+    }
 
-    mpv->waitEvent();
+    wakeupPending = false;
+    {
+      Metrics::Probe probe(&metrics, Metrics::PHASE_MPV_EVENTS);
+      if (mpv->processEvents()) invalidate();
+    }
+    updateScan();
+
+    // bursts of events are coalesced to the fps limit, video frames are presented on their own schedule
+    double now = glfwGetTime();
+    if (now < lastFrameAt + 1.0 / config->Data.Interface.Fps && videoDelay() != 0) {
+      redraw = true;
+      continue;
+    }
 
+    if (animating(now) || !ImGui::GetCurrentContext()->InputEventsQueue.empty()) invalidate();
+    flushInput();
     render();
     updateCursor();
-
-    double targetDelta = 1.0f / config->Data.Interface.Fps;
-    double delta = lastTime - glfwGetTime();
-    if (delta > 0 && delta < targetDelta)
-      glfwWaitEventsTimeout(delta);
-    else
-      lastTime = glfwGetTime();
-    lastTime += targetDelta;
+    lastFrameAt = now;
+    redraw = false;
   }
 
-  shutdown = true;
-  videoWaiter.notify();
-  videoRenderer.join();
-
+  scanner.stop();
+  stopVideo();
   saveState();
 }
 
-void Window::wakeup() { glfwPostEmptyEvent(); }
+void Window::wakeup() {
+  if (!wakeupPending.exchange(true)) glfwPostEmptyEvent();
+}
+
+// seconds to wait for events before the next frame is needed, -1 to wait indefinitely
+double Window::waitTimeout() {
+  double now = glfwGetTime();
+  double frameAt = lastFrameAt + 1.0 / config->Data.Interface.Fps;
+  if (redraw) return std::max(0.0, frameAt - now);
+
+  double deadline = INFINITY;
+  if (animating(now)) deadline = frameAt;
+  if (double delay = videoDelay(); delay >= 0) deadline = std::min(deadline, now + delay);
+  if (double cursorAt = cursorDeadline(); cursorAt > now) deadline = std::min(deadline, cursorAt);
+
+  if (deadline == INFINITY) return -1;
+  return std::max(0.0, deadline - now);
+}
+
+// ImGui needs a few frames after input for hover effects, tooltips and popups, or continuously while editing text
+bool Window::animating(double now) {
+  auto &io = ImGui::GetIO();
+  if (!glfwGetWindowAttrib(window, GLFW_VISIBLE) || glfwGetWindowAttrib(window, GLFW_ICONIFIED)) return false;
+  return now - lastInputAt < INPUT_SETTLE_TIME || io.WantTextInput || ImGui::IsAnyMouseDown();
+}
+
+double Window::cursorDeadline() {
+  auto state = mpv->state();
+  auto &autohide = state->cursorAutohide;
+  if (!ownCursor || autohide == "" || autohide == "no" || autohide == "always") return 0;
+  return lastInputAt + std::stoi(autohide) / 1000.0;
+}
 
 void Window::updateCursor() {
-  if (!ownCursor || mpv->cursorAutohide == "" || ImGui::GetIO().WantCaptureMouse || ImGui::IsMouseDragging(0)) return;
+  auto state = mpv->state();
+  auto &autohide = state->cursorAutohide;
+  if (!ownCursor || autohide == "" || ImGui::GetIO().WantCaptureMouse || ImGui::IsMouseDragging(0)) return;
 
   bool cursor = true;
-  if (mpv->cursorAutohide == "no")
+  if (autohide == "no")
     cursor = true;
-  else if (mpv->cursorAutohide == "always")
+  else if (autohide == "always")
     cursor = false;
   else
-    cursor = (glfwGetTime() - lastInputAt) * 1000 < std::stoi(mpv->cursorAutohide);
+    cursor = (glfwGetTime() - lastInputAt) * 1000 < std::stoi(autohide);
   glfwSetInputMode(window, GLFW_CURSOR, cursor ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_HIDDEN);
   ImGui::SetMouseCursor(cursor ? ImGuiMouseCursor_Arrow : ImGuiMouseCursor_None);
 }
@@ -175,25 +289,37 @@ void Window::installCallbacks(GLFWwindow* target) {
     win->config->Data.Interface.Scale = std::max(x, y);
     win->config->FontReload = true;
   });
+  glfwSetWindowRefreshCallback(target, [](GLFWwindow* window) {
+    auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    win->invalidate();
+  });
+  glfwSetWindowFocusCallback(target, [](GLFWwindow* window, int focused) {
+    auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    win->invalidate();
+  });
   glfwSetWindowCloseCallback(target, [](GLFWwindow* window) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->shutdown();
   });
   glfwSetWindowSizeCallback(target, [](GLFWwindow* window, int w, int h) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    win->invalidate();
     win->render();
   });
   glfwSetWindowPosCallback(target, [](GLFWwindow* window, int x, int y) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    win->invalidate();
     win->render();
   });
   glfwSetCursorEnterCallback(target, [](GLFWwindow* window, int entered) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->ownCursor = entered;
+    win->invalidate();
   });
   glfwSetCursorPosCallback(target, [](GLFWwindow* window, double x, double y) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->lastInputAt = glfwGetTime();
+    win->invalidate();
     if (ImGui::GetIO().WantCaptureMouse) return;
 #ifdef __APPLE__
     float xscale, yscale;
@@ -203,7 +329,7 @@ void Window::installCallbacks(GLFWwindow* target) {
 #endif
     win->onCursorEvent(x, y);
 #ifdef GLFW_PATCHED
-    if (win->mpv->allowDrag() && win->height - y > 280) {  // 280: height of the OSC bar
+    if (win->mpv->state()->allowDrag() && win->height - y > 280) {  // 280: height of the OSC bar
       if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) glfwDragWindow(window);
     }
 #endif
@@ -211,67 +337,61 @@ void Window::installCallbacks(GLFWwindow* target) {
   glfwSetMouseButtonCallback(target, [](GLFWwindow* window, int button, int action, int mods) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->lastInputAt = glfwGetTime();
+    win->invalidate();
     if (!ImGui::GetIO().WantCaptureMouse) win->handleMouse(button, action, mods);
   });
   glfwSetScrollCallback(target, [](GLFWwindow* window, double x, double y) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->lastInputAt = glfwGetTime();
+    win->invalidate();
     if (!ImGui::GetIO().WantCaptureMouse) win->onScrollEvent(x, y);
   });
   glfwSetKeyCallback(target, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->lastInputAt = glfwGetTime();
+    win->invalidate();
     if (!ImGui::GetIO().WantCaptureKeyboard) win->handleKey(key, action, mods);
   });
   glfwSetDropCallback(target, [](GLFWwindow* window, int count, const char** paths) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    win->invalidate();
     if (!ImGui::GetIO().WantCaptureMouse) win->onDropEvent(count, paths);
   });
 }
 
 void Window::handleKey(int key, int action, int mods) {
-  std::string name;
-  if (mods & GLFW_MOD_SHIFT) {
-    if (auto s = shiftMappings.find(key); s != shiftMappings.end()) {
-      name = s->second;
-      mods &= ~GLFW_MOD_SHIFT;
-    }
-  }
-  if (name.empty()) {
-    auto s = keyMappings.find(key);
-    if (s == keyMappings.end()) return;
-    name = s->second;
-  }
-
-  std::vector<std::string> keys;
-  translateMod(keys, mods);
-  keys.push_back(name);
-  sendKeyEvent(fmt::format("{}", join(keys, "+")), action);
+  if (key < 0 || key > GLFW_KEY_LAST) return;
+  const char* name = nullptr;
+  if ((mods & GLFW_MOD_SHIFT) && (name = shiftNames[key]) != nullptr) mods &= ~GLFW_MOD_SHIFT;
+  if (name == nullptr) name = keyNames[key];
+  if (name != nullptr) sendKeyEvent(name, mods, action);
 }
 
 void Window::handleMouse(int button, int action, int mods) {
-  std::vector<std::string> keys;
-  translateMod(keys, mods);
-  auto s = mbtnMappings.find(button);
-  if (s == mbtnMappings.end()) return;
-  keys.push_back(s->second);
-  sendKeyEvent(fmt::format("{}", join(keys, "+")), action);
+  if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST || mbtnNames[button] == nullptr) return;
+  sendKeyEvent(mbtnNames[button], mods, action);
 }
 
-void Window::sendKeyEvent(std::string key, bool action) {
+// formats the modifiers and key name into mpv's key syntax, e.g. Ctrl+Shift+LEFT
+void Window::sendKeyEvent(const char* name, int mods, int action) {
+  char key[64];
+  char* end = key;
+  auto append = [&](std::string_view s) {
+    end = std::copy_n(s.data(), std::min(s.size(), size_t(key + sizeof(key) - 1 - end)), end);
+  };
+  if (mods & GLFW_MOD_CONTROL) append("Ctrl+");
+  if (mods & GLFW_MOD_ALT) append("Alt+");
+  if (mods & GLFW_MOD_SHIFT) append("Shift+");
+  if (mods & GLFW_MOD_SUPER) append("Meta+");
+  append(name);
+  *end = '\0';
+
   if (action == GLFW_PRESS)
     onKeyDownEvent(key);
   else if (action == GLFW_RELEASE)
     onKeyUpEvent(key);
 }
 
-void Window::translateMod(std::vector<std::string>& keys, int mods) {
-  if (mods & GLFW_MOD_CONTROL) keys.emplace_back("Ctrl");
-  if (mods & GLFW_MOD_ALT) keys.emplace_back("Alt");
-  if (mods & GLFW_MOD_SHIFT) keys.emplace_back("Shift");
-  if (mods & GLFW_MOD_SUPER) keys.emplace_back("Meta");
-}
-
 #ifdef _WIN32
 int64_t Window::GetWid() { return config->Data.Mpv.UseWid ? static_cast<uint32_t>((intptr_t)hwnd) : 0; }
 #endif
@@ -298,6 +418,8 @@ void Window::GetFramebufferSize(int* w, int* h) { glfwGetFramebufferSize(window,
 
 void Window::MakeContextCurrent() { glfwMakeContextCurrent(window); }
 
+void Window::MakeVideoContextCurrent() { glfwMakeContextCurrent(videoWindow); }
+
 void Window::DeleteContext() { glfwMakeContextCurrent(nullptr); }
 
 void Window::SwapBuffers() { glfwSwapBuffers(window); }
@@ -462,24 +584,4 @@ LRESULT CALLBACK Window::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPa
   return ::CallWindowProc(win->wndProcOld, hWnd, uMsg, wParam, lParam);
 }
 #endif
-
-void Window::Waiter::wait() {
-  std::unique_lock<std::mutex> l(lock);
-  cond.wait(l, [this] { return notified; });
-  notified = false;
-}
-
-void Window::Waiter::wait_until(std::chrono::steady_clock::time_point time) {
-  std::unique_lock<std::mutex> l(lock);
-  cond.wait_until(l, time, [this] { return notified; });
-  notified = false;
-}
-
-void Window::Waiter::notify() {
-  {
-    std::lock_guard<std::mutex> l(lock);
-    notified = true;
-  }
-  cond.notify_one();
-}
 }  // namespace ImPlay
\ No newline at end of file